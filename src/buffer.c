@@ -0,0 +1,87 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* Project headers */
+#include "osh.h"
+
+
+/* Initial size of a buffer */
+#define BUF_CHUNK  4096
+
+
+/* Make room for at least [n] more bytes (plus the string terminator) */
+static void grow (osh_buf_t * buf, size_t n)
+{
+  if (buf -> len + n + 1 > buf -> size)
+    {
+      size_t size = buf -> size ? buf -> size : BUF_CHUNK;
+
+      while (buf -> len + n + 1 > size)
+	size *= 2;
+
+      buf -> data = realloc (buf -> data, size);
+      buf -> size = size;
+    }
+}
+
+
+/* Empty the buffer without releasing its memory */
+void osh_buf_reset (osh_buf_t * buf)
+{
+  buf -> len = 0;
+  if (buf -> data)
+    * buf -> data = 0x00;
+}
+
+
+/* Release the memory used by the buffer */
+void osh_buf_free (osh_buf_t * buf)
+{
+  safefree (buf -> data);
+  buf -> data = NULL;
+  buf -> len  = 0;
+  buf -> size = 0;
+}
+
+
+/* Append [n] bytes of [s] */
+void osh_buf_cat (osh_buf_t * buf, const char * s, size_t n)
+{
+  grow (buf, n);
+  if (n)
+    memcpy (buf -> data + buf -> len, s, n);
+  buf -> len += n;
+  buf -> data [buf -> len] = 0x00;
+}
+
+
+/* Append the null terminated string [s] */
+void osh_buf_puts (osh_buf_t * buf, const char * s)
+{
+  if (s)
+    osh_buf_cat (buf, s, strlen (s));
+}
+
+
+/* Append [n] times the character [c] */
+void osh_buf_pad (osh_buf_t * buf, char c, size_t n)
+{
+  grow (buf, n);
+  memset (buf -> data + buf -> len, c, n);
+  buf -> len += n;
+  buf -> data [buf -> len] = 0x00;
+}
+
+
+/* Write the content of the buffer to [fd] */
+size_t osh_buf_write (osh_buf_t * buf, FILE * fd)
+{
+  return buf -> len ? fwrite (buf -> data, 1, buf -> len, fd) : 0;
+}
@@ -68,7 +68,6 @@ int osh_chc (int argc, char * argv [])
   bool quiet      = false;
 
   osh_connection_t * conn;
-  unsigned id;
   int option;
 
   /* Lookup for the command in the static table of registered extensions */
@@ -104,9 +103,8 @@ int osh_chc (int argc, char * argv [])
 	  break;
 
 	case 1:
-	  /* Check for a legal identifier and retrieve the connection handler */
-	  id = atoi (argv [argc - 1]);
-	  conn = get_connection (id);
+	  /* Check for a legal identifier (or tag, TNS name, user) and retrieve the connection handler */
+	  conn = find_connection (argv [argc - 1]);
 	  if (! conn)
 	    {
 	      if (! quiet)
@@ -117,7 +115,7 @@ int osh_chc (int argc, char * argv [])
 	  /* Keep track of given connection */
 	  set_current_connection (conn);
 
-	  printf ("%s: current now %u\n", progname, id);
+	  printf ("%s: current now %u\n", progname, conn -> id);
 
 	  /* Update user prompt to include the current connection */
 	  osh_prompt (osh_connection_name (conn));
@@ -27,11 +27,13 @@ static osh_command_t * commands [] =
   & cmd_chc,
 
   & cmd_select,
+  & cmd_xselect,
 
   & cmd_tables,
   & cmd_describe,
 
   & cmd_ping,
+  & cmd_each,
 
   NULL
 };
@@ -21,14 +21,74 @@
 /* Public variable */
 osh_command_t cmd_connect = { NAME, BRIEF, SYNOPSIS, DESCRIPTION, osh_connect };
 
+/* Default # of concurrent logons and seconds to wait for each of them with --from */
+#define DEFAULT_JOBS     8
+#define DEFAULT_TIMEOUT  30
+
+
 static bool interrupted = false;
 
+/* Workers still running, even those the shell has given up on (a logon can hang) */
+static unsigned outstanding = 0;
+
+
+/* The state of a target in a connection list */
+typedef enum
+{
+  TARGET_WAITING,
+  TARGET_RUNNING,
+  TARGET_DONE,
+  TARGET_TIMEOUT,
+  TARGET_SKIPPED
+
+} target_state_t;
+
+
+/* A target in a connection list */
+typedef struct
+{
+  char * name;              /* TNS name, connect descriptor or wallet alias */
+  char * user;              /* NULL for external credentials (wallet)       */
+  char * pass;
+  char * tag;               /* optional name after the target               */
+  target_state_t state;
+  rtime_t started;          /* logon time at nsec resolution                */
+  rtime_t elapsed;
+  osh_connection_t * conn;  /* NULL if failed                               */
+
+} target_t;
+
+
+/* A connection list being connected by a pool of threads */
+typedef struct
+{
+  pthread_mutex_t lock;
+  pthread_cond_t changed;   /* a target has been done                       */
+
+  target_t * targets;
+  unsigned n;
+  unsigned next;            /* next target to connect                       */
+  unsigned left;            /* targets neither done nor given up            */
+  unsigned refs;            /* the threads and the shell                    */
+  unsigned workers;         /* threads still taking targets                 */
+  bool abandoned;           /* the shell does not wait any longer           */
+
+  /* How to connect */
+  unsigned min;
+  unsigned max;
+  unsigned incr;
+  bool drcp;
+  char * cclass;
+  char * purity;
+  bool lazy;                /* defer the logons until first use             */
+
+} batch_t;
+
 
 /* What to do on ^C */
 static void on_ctrl_c (int signo)
 {
   interrupted = true;
-  fflush (stdout);
 }
 
 
@@ -42,7 +102,24 @@ enum
   /* Database */
   OPT_TNSNAME = 'n',    /* TNS Name */
   OPT_USER    = 'u',    /* User     */
-  OPT_PASS    = 'p'     /* Password */
+  OPT_PASS    = 'p',    /* Password */
+  OPT_TAG     = 'T',    /* Tag      */
+
+  /* Connection list */
+  OPT_FROM    = 'f',
+  OPT_JOBS    = 'j',
+  OPT_TIMEOUT = 't',
+
+  /* Session pool */
+  OPT_POOL    = 'P',
+
+  /* Deferred logon */
+  OPT_LAZY    = 'l',
+
+  /* Database resident connection pooling */
+  OPT_DRCP    = 'D',
+  OPT_CCLASS  = 'C',
+  OPT_PURITY  = 'R'
 };
 
 
@@ -50,15 +127,32 @@ enum
 static struct option lopts [] =
 {
   /* Startup */
-  { "help",  no_argument,       NULL, OPT_HELP    },
-  { "quiet", no_argument,       NULL, OPT_QUIET   },
+  { "help",    no_argument,       NULL, OPT_HELP    },
+  { "quiet",   no_argument,       NULL, OPT_QUIET   },
 
   /* Database */
-  { "name",  required_argument, NULL, OPT_TNSNAME },
-  { "user",  required_argument, NULL, OPT_USER    },
-  { "pass",  required_argument, NULL, OPT_PASS    },
+  { "name",    required_argument, NULL, OPT_TNSNAME },
+  { "user",    required_argument, NULL, OPT_USER    },
+  { "pass",    required_argument, NULL, OPT_PASS    },
+  { "tag",     required_argument, NULL, OPT_TAG     },
+
+  /* Connection list */
+  { "from",    required_argument, NULL, OPT_FROM    },
+  { "jobs",    required_argument, NULL, OPT_JOBS    },
+  { "timeout", required_argument, NULL, OPT_TIMEOUT },
 
-  { NULL,    0,                 NULL, 0           }
+  /* Session pool */
+  { "pool",    required_argument, NULL, OPT_POOL    },
+
+  /* Deferred logon */
+  { "lazy",    no_argument,       NULL, OPT_LAZY    },
+
+  /* Database resident connection pooling */
+  { "drcp",    no_argument,       NULL, OPT_DRCP    },
+  { "cclass",  required_argument, NULL, OPT_CCLASS  },
+  { "purity",  required_argument, NULL, OPT_PURITY  },
+
+  { NULL,      0,                 NULL, 0           }
 };
 
 
@@ -81,6 +175,389 @@ static void usage (char * progname, struct option * options)
   usage_item (options, n, OPT_TNSNAME, "TNS name");
   usage_item (options, n, OPT_USER,    "user");
   usage_item (options, n, OPT_PASS,    "password");
+  usage_item (options, n, OPT_TAG,     "name to refer to the connection (eg. chc name)");
+  printf ("\n");
+
+  printf ("Connection list:\n");
+  usage_item (options, n, OPT_FROM,    "connect to all the user/pass@tns [tag] (or wallet aliases) listed in a file");
+  usage_item (options, n, OPT_JOBS,    "# of concurrent logons");
+  usage_item (options, n, OPT_TIMEOUT, "seconds to wait for each logon (0 means no limit)");
+  printf ("\n");
+
+  printf ("Session pool:\n");
+  usage_item (options, n, OPT_POOL,    "connect via a pool of min,max[,incr] sessions");
+  printf ("\n");
+
+  printf ("Deferred logon:\n");
+  usage_item (options, n, OPT_LAZY,    "do not connect until the connection is used by a command");
+  printf ("\n");
+
+  printf ("Database resident connection pooling:\n");
+  usage_item (options, n, OPT_DRCP,    "attach to a pooled server (TNS aliases must have SERVER=POOLED)");
+  usage_item (options, n, OPT_CCLASS,  "connection class of the pooled servers");
+  usage_item (options, n, OPT_PURITY,  "session purity (self or new)");
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* Can [tag] name a new connection? (tags have to be unique and not to be taken for identifiers) */
+static bool valid_tag (char * tag)
+{
+  osh_connection_t * other = find_connection (tag);
+
+  return strspn (tag, "0123456789") != strlen (tag) && ! (other && other -> tag && ! strcmp (other -> tag, tag));
+}
+
+
+/* Attempt to connect to [name] as configured by the command line options (or just keep the credentials if lazy) */
+static osh_connection_t * open_connection (batch_t * how, char * name, char * user, char * pass)
+{
+  osh_connection_t * conn;
+  char * original = name;
+  char * pooled   = NULL;
+
+  /* Rewrite the connect string to attach to a pooled server */
+  if (how -> drcp && ! (name = pooled = ocilib_drcp_name (name, how -> cclass, how -> purity)))
+    return NULL;
+
+  if (how -> lazy)
+    {
+      conn = osh_connection_alloc (NULL);
+      conn -> logon = osh_logon_alloc (name, user, pass, how -> min, how -> max, how -> incr);
+    }
+  else if (how -> max)
+    conn = ocilib_connect_pool (name, user, pass, how -> min, how -> max, how -> incr);
+  else
+    conn = ocilib_connect (name, user, pass);
+
+  /* TNS aliases are taken as they are, so DRCP is up to their SERVER=POOLED */
+  if (conn && pooled && * original != '(' && ! strpbrk (original, "/:"))
+    conn -> cclass = strdup ("(alias)");
+  else if (conn && pooled)
+    conn -> cclass = strdup (how -> cclass ? how -> cclass : "");
+
+  safefree (pooled);
+
+  return conn;
+}
+
+
+/* Split a line of a connection list (user/pass@tns, or just a wallet alias, then an optional tag) */
+static void parse_target (char * line, target_t * t)
+{
+  char * blank = strpbrk (line, " \t");
+  char * at;
+  char * slash;
+
+  if (blank)
+    {
+      * blank = 0x00;
+      blank += strspn (blank + 1, " \t") + 1;
+      t -> tag = * blank ? strdup (blank) : NULL;
+    }
+
+  at = strrchr (line, '@');
+
+  if (at)
+    {
+      * at = 0x00;
+      if ((slash = strchr (line, '/')))
+	{
+	  * slash = 0x00;
+	  t -> pass = * (slash + 1) ? strdup (slash + 1) : NULL;
+	}
+      t -> user = * line ? strdup (line) : NULL;
+      t -> name = strdup (at + 1);
+    }
+  else
+    t -> name = strdup (line);
+}
+
+
+/* Read the targets listed in [filename] (blank lines and # comments are skipped) */
+static target_t * read_targets (char * filename, unsigned * n)
+{
+  FILE * fd = fopen (filename, "r");
+  target_t * targets = NULL;
+  char line [MAXLINE];
+
+  * n = 0;
+  if (! fd)
+    return NULL;
+
+  while (fgets (line, sizeof (line), fd))
+    {
+      char * s = line + strspn (line, " \t");
+      char * e = s + strlen (s);
+
+      while (e > s && strchr (" \t\r\n", e [-1]))
+	* -- e = 0x00;
+      if (! * s || * s == '#')
+	continue;
+
+      targets = realloc (targets, (* n + 1) * sizeof (target_t));
+      memset (& targets [* n], 0, sizeof (target_t));
+      parse_target (s, & targets [(* n) ++]);
+    }
+  fclose (fd);
+
+  return targets;
+}
+
+
+/* Drop a reference to [batch] and release it with the last one (called holding its lock) */
+static void batch_leave (batch_t * batch)
+{
+  unsigned i;
+
+  if (-- batch -> refs)
+    {
+      pthread_mutex_unlock (& batch -> lock);
+      return;
+    }
+  pthread_mutex_unlock (& batch -> lock);
+
+  for (i = 0; i < batch -> n; i ++)
+    {
+      safefree (batch -> targets [i] . name);
+      safefree (batch -> targets [i] . user);
+      safefree (batch -> targets [i] . pass);
+      safefree (batch -> targets [i] . tag);
+    }
+  free (batch -> targets);
+  pthread_mutex_destroy (& batch -> lock);
+  pthread_cond_destroy (& batch -> changed);
+  free (batch);
+}
+
+
+/*
+ * A worker: connect to the next target until none is left.  A worker
+ * whose logon has timed out quits once the logon returns, since another
+ * one has been started in its place.
+ */
+static void * connect_targets (void * arg)
+{
+  batch_t * batch = arg;
+  bool replaced   = false;
+
+  pthread_mutex_lock (& batch -> lock);
+  while (! replaced && batch -> next < batch -> n && ! batch -> abandoned)
+    {
+      target_t * t = & batch -> targets [batch -> next ++];
+      osh_connection_t * conn;
+
+      t -> state   = TARGET_RUNNING;
+      t -> started = nswall ();
+      pthread_mutex_unlock (& batch -> lock);
+
+      conn = open_connection (batch, t -> name, t -> user, t -> pass);
+
+      pthread_mutex_lock (& batch -> lock);
+      if (t -> state == TARGET_RUNNING)
+	{
+	  t -> state   = TARGET_DONE;
+	  t -> elapsed = nswall () - t -> started;
+	  t -> conn    = conn;
+	  batch -> left --;
+	  pthread_cond_signal (& batch -> changed);
+	}
+      else
+	{
+	  osh_connection_free (conn);           /* too late, the shell has given up */
+	  replaced = true;
+	}
+    }
+  batch -> workers --;
+  pthread_cond_signal (& batch -> changed);
+  batch_leave (batch);
+
+  /* Done with the library */
+  __atomic_sub_fetch (& outstanding, 1, __ATOMIC_SEQ_CST);
+
+  return NULL;
+}
+
+
+/* Start one more worker for [batch] (called holding its lock) */
+static bool start_worker (batch_t * batch)
+{
+  pthread_t tid;
+
+  __atomic_add_fetch (& outstanding, 1, __ATOMIC_SEQ_CST);
+  if (pthread_create (& tid, NULL, connect_targets, batch))
+    {
+      __atomic_sub_fetch (& outstanding, 1, __ATOMIC_SEQ_CST);
+      return false;
+    }
+
+  pthread_detach (tid);
+  batch -> refs ++;
+  batch -> workers ++;
+
+  return true;
+}
+
+
+/* Print the outcome of each target in a table */
+static void print_targets (target_t * targets, unsigned n)
+{
+  mx_t * mx = mxalloc (n + 1, 5);
+  unsigned r;
+
+  mxcpy (mx, "#",        0, 0);
+  mxcpy (mx, "TNS Name", 0, 1);
+  mxcpy (mx, "User",     0, 2);
+  mxcpy (mx, "Status",   0, 3);
+  mxcpy (mx, "Time",     0, 4);
+
+  for (r = 1; r <= n; r ++)
+    {
+      target_t * t = & targets [r - 1];
+      char * status;
+
+      switch (t -> state)
+	{
+	case TARGET_DONE:    status = t -> conn ? "Ok" : "Failed"; break;
+	case TARGET_TIMEOUT: status = "Timeout";                    break;
+	default:             status = "Skipped";                    break;
+	}
+
+      mxcpy (mx, utoa (r),                                             r, 0);
+      mxcpy (mx, t -> name,                                            r, 1);
+      mxcpy (mx, t -> user ? t -> user : "(wallet)",                   r, 2);
+      mxcpy (mx, status,                                               r, 3);
+      mxcpy (mx, t -> state == TARGET_DONE ? ns2a (t -> elapsed) : "", r, 4);
+    }
+
+  mxprint (mx);
+  mxfree (mx);
+}
+
+
+/*
+ * Connect to all the targets listed in [filename] using [jobs] threads,
+ * giving up on those not connected within [timeout] seconds, and add
+ * the connections to the table in the same order of the file.
+ * Return the # of connections added.
+ */
+static unsigned connect_from (char * progname, char * filename, batch_t * how, unsigned jobs, unsigned timeout, bool quiet)
+{
+  batch_t * batch = calloc (1, sizeof (batch_t));
+  osh_connection_t * last = NULL;
+  unsigned added = 0;
+  unsigned i;
+  unsigned j;
+
+  * batch = * how;
+  if (! (batch -> targets = read_targets (filename, & batch -> n)))
+    {
+      if (! quiet)
+	printf ("%s: cannot read targets from [%s]\n", progname, filename);
+      free (batch);
+      return 0;
+    }
+  pthread_mutex_init (& batch -> lock, NULL);
+  pthread_cond_init (& batch -> changed, NULL);
+  batch -> left = batch -> n;
+  batch -> refs = 1;
+
+  /* The tags in the file are checked as those given with --tag (and against each other) */
+  for (i = 0; i < batch -> n; i ++)
+    if (batch -> targets [i] . tag)
+      {
+	bool valid = valid_tag (batch -> targets [i] . tag);
+
+	for (j = 0; j < i && valid; j ++)
+	  valid = ! batch -> targets [j] . tag || strcmp (batch -> targets [j] . tag, batch -> targets [i] . tag);
+
+	if (! valid)
+	  {
+	    if (! quiet)
+	      printf ("%s: Invalid or duplicate tag [%s] in [%s].\n", progname, batch -> targets [i] . tag, filename);
+	    pthread_mutex_lock (& batch -> lock);
+	    batch_leave (batch);
+	    return 0;
+	  }
+      }
+
+  if (! quiet)
+    osh_progress ("%s: connecting to #%u databases ... ", progname, batch -> n);
+
+  /* Start the workers */
+  pthread_mutex_lock (& batch -> lock);
+  for (i = 0; i < RMIN (RMAX (1, jobs), batch -> n); i ++)
+    start_worker (batch);
+
+  /* Wait for all the targets (checking for ^C and for the logons taking too long) */
+  while (batch -> workers && batch -> left && ! interrupted)
+    {
+      struct timespec ts;
+      rtime_t now;
+
+      clock_gettime (CLOCK_REALTIME, & ts);
+      ts . tv_nsec += 100 * 1000 * 1000;
+      ts . tv_sec  += ts . tv_nsec / 1000000000;
+      ts . tv_nsec %= 1000000000;
+      pthread_cond_timedwait (& batch -> changed, & batch -> lock, & ts);
+
+      now = nswall ();
+      for (i = 0; i < batch -> n && timeout; i ++)
+	if (batch -> targets [i] . state == TARGET_RUNNING && now - batch -> targets [i] . started > (rtime_t) timeout * 1000000000)
+	  {
+	    /* The worker is stuck in the logon, another one takes its place */
+	    batch -> targets [i] . state = TARGET_TIMEOUT;
+	    batch -> left --;
+	    if (batch -> next < batch -> n)
+	      start_worker (batch);
+	  }
+    }
+
+  /* Give up on the targets still waiting or running */
+  batch -> abandoned = true;
+  for (i = 0; i < batch -> n; i ++)
+    if (batch -> targets [i] . state == TARGET_WAITING || batch -> targets [i] . state == TARGET_RUNNING)
+      batch -> targets [i] . state = TARGET_SKIPPED;
+
+  /* Add the connections in the same order of the file */
+  for (i = 0; i < batch -> n; i ++)
+    if (batch -> targets [i] . conn)
+      {
+	last = batch -> targets [i] . conn;
+	last -> tag = safedup (batch -> targets [i] . tag);
+	add_connection (last);
+	added ++;
+      }
+
+  if (! quiet)
+    {
+      printf ("Ok! #%u of #%u connected\n", added, batch -> n);
+      print_targets (batch -> targets, batch -> n);
+    }
+
+  /* The workers still in a logon release the batch when done */
+  batch_leave (batch);
+
+  /* The last one becomes the current connection */
+  if (last)
+    {
+      set_current_connection (last);
+      osh_prompt (osh_connection_name (last));
+    }
+
+  return added;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* # of logons still running in the background (the library cannot be cleaned up meanwhile) */
+unsigned connect_pending (void)
+{
+  return __atomic_load_n (& outstanding, __ATOMIC_SEQ_CST);
 }
 
 
@@ -95,10 +572,22 @@ int osh_connect (int argc, char * argv [])
   char * name     = DEFAULT_NAME;
   char * user     = DEFAULT_USER;
   char * pass     = DEFAULT_PASS;
+  char * tag      = NULL;
+  unsigned min    = 0;             /* session pool (max 0 means a dedicated connection) */
+  unsigned max    = 0;
+  unsigned incr   = 1;
+  bool drcp       = false;
+  char * cclass   = NULL;
+  char * purity   = NULL;
+  bool lazy       = false;
+  char * from     = NULL;          /* connection list */
+  unsigned jobs   = DEFAULT_JOBS;
+  unsigned timeout = DEFAULT_TIMEOUT;
 
   /* signal handler */
   void (* on_prev) (int);
 
+  batch_t how;
   osh_connection_t * conn;
   int option;
 
@@ -124,12 +613,69 @@ int osh_connect (int argc, char * argv [])
 	case OPT_QUIET:   quiet = true;            break;
 
 	  /* Database */
-	case OPT_TNSNAME: name = optarg;    break;
-	case OPT_USER:    user = optarg;    break;
-	case OPT_PASS:    pass = optarg;    break;
+	case OPT_TNSNAME: name = optarg;            break;
+	case OPT_USER:    user = optarg;            break;
+	case OPT_PASS:    pass = optarg;            break;
+	case OPT_TAG:     tag = optarg;             break;
+
+	  /* Connection list */
+	case OPT_FROM:    from = optarg;            break;
+	case OPT_JOBS:    jobs = atoi (optarg);     break;
+	case OPT_TIMEOUT: timeout = atoi (optarg);  break;
+
+	  /* Session pool */
+	case OPT_POOL:
+	  if (sscanf (optarg, "%u,%u,%u", & min, & max, & incr) < 2 || ! max || min > max || ! incr)
+	    {
+	      if (! quiet)
+		printf ("%s: Invalid pool size [%s] (min,max[,incr] expected).\n", progname, optarg);
+	      return 1;
+	    }
+	  break;
+
+	  /* Deferred logon */
+	case OPT_LAZY:    lazy = true;              break;
+
+	  /* Database resident connection pooling */
+	case OPT_DRCP:    drcp = true;                   break;
+	case OPT_CCLASS:  drcp = true; cclass = optarg;  break;
+	case OPT_PURITY:
+	  if (strcasecmp (optarg, "self") && strcasecmp (optarg, "new"))
+	    {
+	      if (! quiet)
+		printf ("%s: Invalid purity [%s] (self or new expected).\n", progname, optarg);
+	      return 1;
+	    }
+	  drcp   = true;
+	  purity = optarg;
+	  break;
 	}
     }
 
+  /* Tags have to be unique and not to be taken for identifiers */
+  if (tag && ! valid_tag (tag))
+    {
+      if (! quiet)
+	printf ("%s: Invalid or duplicate tag [%s].\n", progname, tag);
+      return 1;
+    }
+
+  /* Check the connect string can be rewritten to attach to a pooled server */
+  if (drcp && ! from)
+    {
+      char * pooled = ocilib_drcp_name (name, cclass, purity);
+
+      if (! pooled)
+	{
+	  if (! quiet && * name == '(')
+	    printf ("%s: No CONNECT_DATA in the connect descriptor.\n", progname);
+	  else if (! quiet)
+	    printf ("%s: TNS aliases cannot be given --cclass or --purity (set them in tnsnames.ora).\n", progname);
+	  return 1;
+	}
+      free (pooled);
+    }
+
   /* Attempt to initialize the ocilib library (ignore errors due to multiple connect/disconnect) */
   if (! osh_run . initialized && ! ocilib_initialize ())
     {
@@ -140,10 +686,32 @@ int osh_connect (int argc, char * argv [])
   /* Enable ^C */
   on_prev = signal (SIGINT, on_ctrl_c);
 
-  /* Create a physical connection to an Oracle database server */
+  /* How to connect */
+  memset (& how, 0, sizeof (how));
+  how . min    = min;
+  how . max    = max;
+  how . incr   = incr;
+  how . drcp   = drcp;
+  how . cclass = cclass;
+  how . purity = purity;
+  how . lazy   = lazy;
+
+  /* Connect to all the targets in a file */
+  if (from)
+    {
+      unsigned added;
+
+      interrupted = false;
+      added = connect_from (progname, from, & how, jobs, timeout, quiet);
+      signal (SIGINT, on_prev);
+
+      return added ? 0 : 1;
+    }
+
+  /* Create a physical connection to an Oracle database server (unless deferred until first use) */
   if (! quiet)
-    printf ("%s: connecting to database '%s:xxx@%s' ... ", progname, user, name);
-  if (! (conn = ocilib_connect (name, user, pass)))
+    osh_progress ("%s: %s database '%s:xxx@%s' ... ", progname, lazy ? "registering" : "connecting to", user, name);
+  if (! (conn = open_connection (& how, name, user, pass)))
     {
       if (! quiet)
 	{
@@ -153,8 +721,8 @@ int osh_connect (int argc, char * argv [])
 	    printf ("\n");
 	}
 
-      /* Clean up all resources allocated by the library */
-      ocilib_cleanup ();
+      /* The library is left initialized for the connections already open (and the monitor) */
+      signal (SIGINT, on_prev);
 
       return 1;
     }
@@ -162,6 +730,7 @@ int osh_connect (int argc, char * argv [])
     printf ("Ok!\n");
 
   /* Add to the table of connections */
+  conn -> tag = safedup (tag);
   add_connection (conn);
 
   /* Keep track of current connection */
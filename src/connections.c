@@ -8,12 +8,145 @@
  */
 
 
+/* System headers */
+#include <fnmatch.h>
+
 /* Project headers */
 #include "osh.h"
 
 
-/* The vector of connections */
+/*
+ * The registry of connections.
+ *
+ * Connections are kept in a list in order of connection and indexed by
+ * id, TNS name, user and tag in hash tables, so that they are looked up
+ * and removed in constant time.  The vector returned to the commands is
+ * built again from the list only when it has changed.
+ */
+
+
+/* # of buckets of each index (a power of 2) */
+#define INDEX_BUCKETS  256
+
+
+/* An entry of an index */
+typedef struct entry
+{
+  char * key;
+  osh_connection_t * conn;
+  struct entry * next;
+
+} entry_t;
+
+
+typedef entry_t * index_t [INDEX_BUCKETS];
+
+
+/* The list of connections and the current one */
+static osh_connection_t * first   = NULL;
+static osh_connection_t * last    = NULL;
+static osh_connection_t * current = NULL;
+static unsigned count             = 0;
+static unsigned next_id           = 1;
+
+/* The indexes */
+static index_t by_id;
+static index_t by_name;
+static index_t by_user;
+static index_t by_tag;
+
+/* The vector of connections (in order of the list) */
 static osh_connection_t ** all_connections = NULL;
+static bool stale                          = false;
+
+
+/* The bucket of [key] */
+static unsigned bucket (char * key)
+{
+  return osh_strhash (key) & (INDEX_BUCKETS - 1);
+}
+
+
+/* Add [conn] to [index] under [key] */
+static void index_add (index_t index, char * key, osh_connection_t * conn)
+{
+  entry_t * e;
+
+  if (! key || ! * key)
+    return;
+
+  e = calloc (1, sizeof (entry_t));
+  e -> key  = strdup (key);
+  e -> conn = conn;
+  e -> next = index [bucket (key)];
+  index [bucket (key)] = e;
+}
+
+
+/* Remove [conn] from [index] (searching all the buckets if it is no longer under [key]) */
+static void index_del (index_t index, char * key, osh_connection_t * conn)
+{
+  unsigned b   = key && * key ? bucket (key) : 0;
+  unsigned end = key && * key ? b + 1 : INDEX_BUCKETS;
+
+  for (; b < end; b ++)
+    {
+      entry_t ** e;
+
+      for (e = & index [b]; * e; e = & (* e) -> next)
+	if ((* e) -> conn == conn)
+	  {
+	    entry_t * gone = * e;
+
+	    * e = gone -> next;
+	    free (gone -> key);
+	    free (gone);
+	    return;
+	  }
+    }
+
+  if (key && * key)
+    index_del (index, NULL, conn);
+}
+
+
+/* Lookup for [key] in [index] (the most recent connection if more than one) */
+static osh_connection_t * index_get (index_t index, char * key)
+{
+  entry_t * e;
+
+  if (! key || ! * key)
+    return NULL;
+
+  for (e = index [bucket (key)]; e; e = e -> next)
+    if (! strcmp (e -> key, key))
+      return e -> conn;
+  return NULL;
+}
+
+
+/* Link again the list in the order of the vector (after it has been sorted) */
+static void relink (void)
+{
+  unsigned i;
+
+  first = last = NULL;
+  for (i = 0; i < count; i ++)
+    {
+      osh_connection_t * conn = all_connections [i];
+
+      conn -> prev = last;
+      conn -> next = NULL;
+      if (last)
+	last -> next = conn;
+      else
+	first = conn;
+      last = conn;
+    }
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
 
 
 /* Sort by TNS name */
@@ -65,18 +198,24 @@ static int rev_sort_by_uptime (const void * a, const void * b)
 
 char * osh_connection_name (osh_connection_t * conn)
 {
+  if (conn && conn -> logon)
+    return conn -> logon -> name;
   return conn && conn -> handle ? (char *) OCI_GetDatabase (conn -> handle) : NULL;
 }
 
 
 char * osh_connection_user (osh_connection_t * conn)
 {
+  if (conn && conn -> logon)
+    return conn -> logon -> user ? conn -> logon -> user : "";
   return conn && conn -> handle ? (char *) OCI_GetUserName (conn -> handle) : NULL;
 }
 
 
 char * osh_connection_pass (osh_connection_t * conn)
 {
+  if (conn && conn -> logon)
+    return conn -> logon -> pass;
   return conn && conn -> handle ? (char *) OCI_GetPassword (conn -> handle) : NULL;
 }
 
@@ -87,6 +226,28 @@ OCI_Connection * osh_connection_handle (osh_connection_t * conn)
 }
 
 
+/* Dedicated connection or session pool with its busy/open sessions (and DRCP connection class if pooled) */
+char * osh_connection_mode (osh_connection_t * conn)
+{
+  static char mode [128];
+
+  if (! conn)
+    return NULL;
+
+  if (conn -> logon)
+    snprintf (mode, sizeof (mode), "lazy");
+  else if (conn -> pool)
+    snprintf (mode, sizeof (mode), "pool %u/%u", OCI_PoolGetBusyCount (conn -> pool), OCI_PoolGetOpenedCount (conn -> pool));
+  else
+    snprintf (mode, sizeof (mode), "dedicated");
+
+  if (conn -> cclass)
+    snprintf (mode + strlen (mode), sizeof (mode) - strlen (mode), ", drcp%s%s", * conn -> cclass ? " " : "", conn -> cclass);
+
+  return mode;
+}
+
+
 rtime_t osh_connection_uptime (osh_connection_t * conn)
 {
   return conn ? conn -> when : 0;
@@ -138,33 +299,64 @@ void osh_set_error (osh_connection_t * conn, char * fmt, ...)
 /* Lookup for working connection in the table of connections */
 osh_connection_t * get_current_connection (void)
 {
-  osh_connection_t ** conns = all_connections;
-  if (conns)
-    while (* conns)
-      {
-	if (osh_connection_get_working (* conns))
-	  return * conns;
-	else
-	  conns ++;
-      }
-  return NULL;
+  return current;
 }
 
 
-/* Lookup for the n-th item in the table of connections */
-osh_connection_t * get_connection (unsigned n)
+/* Lookup for the working connection, connecting it now if its logon has been deferred */
+osh_connection_t * get_active_connection (void)
 {
-  return all_connections && n > 0 && n < len_connections () + 1 ? all_connections [n - 1] : NULL;
+  osh_connection_t * conn = get_current_connection ();
+
+  if (conn && conn -> logon && ! ocilib_logon (conn))
+    osh_set_error (conn, "Cannot connect to database '%s'", osh_connection_name (conn));
+
+  return conn;
+}
+
+
+/* Lookup for the connection with identifier [id] */
+osh_connection_t * get_connection (unsigned id)
+{
+  return id ? index_get (by_id, utoa (id)) : NULL;
+}
+
+
+/* Lookup for a connection by identifier, tag, TNS name or user (in this order) */
+osh_connection_t * find_connection (char * what)
+{
+  osh_connection_t * conn;
+
+  if (! what || ! * what)
+    return NULL;
+
+  if (strspn (what, "0123456789") == strlen (what))
+    return get_connection (atoi (what));
+
+  if ((conn = index_get (by_tag, what)))
+    return conn;
+  if ((conn = index_get (by_name, what)))
+    return conn;
+  return index_get (by_user, what);
+}
+
+
+/* Does [conn] match [pattern]? (either its tag or its TNS name, any connection if NULL) */
+bool osh_connection_matches (osh_connection_t * conn, char * pattern)
+{
+  return ! pattern
+    || (conn -> tag && ! fnmatch (pattern, conn -> tag, 0))
+    || ! fnmatch (pattern, osh_connection_name (conn), 0);
 }
 
 
 /* Set [conn] as the current connection */
 void set_current_connection (osh_connection_t * conn)
 {
-  osh_connection_t * c = get_current_connection ();
-  if (c)
-    osh_connection_set_working (c, false);
+  if (current)
+    osh_connection_set_working (current, false);
   osh_connection_set_working (conn, true);
+  current = conn;
 }
 
 
@@ -172,23 +364,21 @@ void set_current_connection (osh_connection_t * conn)
 void reset_current_connection (osh_connection_t * conn)
 {
   /* Most recent becomes the current */
-  osh_connection_t ** all = all_connections;
-  osh_connection_t * c    = NULL;
-  rtime_t newer           = 0;
+  osh_connection_t * c = NULL;
+  osh_connection_t * all;
+  rtime_t newer        = 0;
 
-  if (all)
-    while (* all)
+  for (all = first; all; all = all -> next)
+    if (all != conn && osh_connection_uptime (all) > newer)
       {
-	if (* all != conn && osh_connection_uptime (* all) > newer)
-	  {
-	    newer = osh_connection_uptime (* all);
-	    c = * all;
-	  }
-	all ++;
+	newer = osh_connection_uptime (all);
+	c = all;
       }
 
+  osh_connection_set_working (conn, false);
+  current = NULL;
   if (c)
-    osh_connection_set_working (c, true);
+    set_current_connection (c);
 }
 
 
@@ -210,25 +400,104 @@ void osh_connection_set_working (osh_connection_t * conn, bool status)
 
 unsigned len_connections (void)
 {
-  return arrlen (all_connections);
+  return count;
 }
 
 
+/* The vector of connections in order of connection (or as last sorted) */
 osh_connection_t ** get_connections (void)
 {
-  return all_connections;
+  if (stale)
+    {
+      osh_connection_t * conn;
+      unsigned i = 0;
+
+      free (all_connections);
+      all_connections = calloc (count + 1, sizeof (osh_connection_t *));
+      for (conn = first; conn; conn = conn -> next)
+	all_connections [i ++] = conn;
+      stale = false;
+    }
+
+  return count ? all_connections : NULL;
 }
 
 
+/* Health of [conn] as seen by the monitor */
+char * osh_connection_health (osh_connection_t * conn)
+{
+  static char health [64];
+
+  if (! conn)
+    return NULL;
+
+  if (conn -> dead)
+    snprintf (health, sizeof (health), "dead");
+  else if (conn -> reconnects)
+    snprintf (health, sizeof (health), "alive (#%u reconnects)", conn -> reconnects);
+  else
+    snprintf (health, sizeof (health), "alive");
+
+  return health;
+}
+
+
+/* Add [conn] at the end of the table of connections and index it (by its tag too, if any) */
 void add_connection (osh_connection_t * conn)
 {
-  all_connections = arrmore (all_connections, conn, osh_connection_t);
+  conn -> id   = next_id ++;
+  conn -> prev = last;
+  conn -> next = NULL;
+  if (last)
+    last -> next = conn;
+  else
+    first = conn;
+  last = conn;
+  count ++;
+
+  index_add (by_id,   utoa (conn -> id),           conn);
+  index_add (by_name, osh_connection_name (conn), conn);
+  index_add (by_user, osh_connection_user (conn), conn);
+  index_add (by_tag,  conn -> tag,                conn);
+  stale = true;
 }
 
 
+/* Remove [conn] from the table of connections and release it */
 void del_connection (osh_connection_t * conn)
 {
-  all_connections = arrless (all_connections, conn, osh_connection_t, osh_connection_done);
+  if (conn -> prev)
+    conn -> prev -> next = conn -> next;
+  else
+    first = conn -> next;
+  if (conn -> next)
+    conn -> next -> prev = conn -> prev;
+  else
+    last = conn -> prev;
+  count --;
+
+  index_del (by_id,   utoa (conn -> id),           conn);
+  index_del (by_name, osh_connection_name (conn), conn);
+  index_del (by_user, osh_connection_user (conn), conn);
+  index_del (by_tag,  conn -> tag,                conn);
+  stale = true;
+
+  if (current == conn)
+    current = NULL;
+
+  osh_connection_free (conn);
+}
+
+
+/* Sort the table of connections by [cmp] */
+static osh_connection_t ** sort_connections (int (* cmp) (const void *, const void *))
+{
+  if (get_connections ())
+    {
+      qsort (all_connections, count, sizeof (osh_connection_t *), cmp);
+      relink ();
+    }
+  return get_connections ();
 }
 
 
@@ -237,35 +506,35 @@ void del_connection (osh_connection_t * conn)
 
 osh_connection_t ** conn_sort_by_tnsname (void)
 {
-  return all_connections = arrsort (all_connections, sort_by_tnsname, osh_connection_t);
+  return sort_connections (sort_by_tnsname);
 }
 
 
 osh_connection_t ** conn_sort_by_user (void)
 {
-  return all_connections = arrsort (all_connections, sort_by_user, osh_connection_t);
+  return sort_connections (sort_by_user);
 }
 
 
 osh_connection_t ** conn_sort_by_uptime (void)
 {
-  return all_connections = arrsort (all_connections, sort_by_uptime, osh_connection_t);
+  return sort_connections (sort_by_uptime);
 }
 
 
 osh_connection_t ** conn_rev_sort_by_tnsname (void)
 {
-  return all_connections = arrsort (all_connections, rev_sort_by_tnsname, osh_connection_t);
+  return sort_connections (rev_sort_by_tnsname);
 }
 
 
 osh_connection_t ** conn_rev_sort_by_user (void)
 {
-  return all_connections = arrsort (all_connections, rev_sort_by_user, osh_connection_t);
+  return sort_connections (rev_sort_by_user);
 }
 
 
 osh_connection_t ** conn_rev_sort_by_uptime (void)
 {
-  return all_connections = arrsort (all_connections, rev_sort_by_uptime, osh_connection_t);
+  return sort_connections (rev_sort_by_uptime);
 }
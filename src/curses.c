@@ -9,6 +9,7 @@
 
 
 /* System headers */
+#include <sys/ioctl.h>
 #include <ncurses.h>
 
 /* Project headers */
@@ -32,10 +33,45 @@
 /* Reserved keys */
 #define KEY_ESC       '\033' /* Escape                       */
 #define KEY_QUIT      'q'    /* Quit Key                     */
+#define KEY_PATTERN   '/'    /* Search forward               */
+#define KEY_MATCH     'n'    /* Next match                   */
+#define KEY_RMATCH    'N'    /* Previous match               */
+#define KEY_SORT      's'    /* Sort by the current column   */
+#define KEY_FILTER    '&'    /* Show only the matching rows  */
+#define KEY_JUMP      ':'    /* Go to row # (or to # %)      */
+
+
+/* Columns never scrolled horizontally (serial and the first one, usually the key) */
+#define FROZEN_COLUMNS  2
 
 
 static unsigned current_row = 0;   /* current row counter */
 
+/* Set when the terminal has been resized */
+static volatile sig_atomic_t winched = 0;
+
+/* The last pattern searched and the message for the user */
+static char pattern [MAXLINE] = "";
+static char status [MAXLINE]  = "";
+
+/* What is currently on the screen, in order to repaint only the lines that changed */
+static char ** painted       = NULL;   /* text of each screen row      */
+static int * painted_attr    = NULL;   /* attributes of each screen row */
+static unsigned painted_rows = 0;
+
+/* The formatted lines of the page currently displayed (column names first) */
+static char ** page          = NULL;
+static size_t * page_columns = NULL;   /* byte offsets of the columns in each line */
+static unsigned page_offset  = 0;
+
+/* The first column shown after the frozen ones (horizontal scrolling) */
+static unsigned hcol         = FROZEN_COLUMNS;
+
+/* The column under the cursor (one-based, serial excluded) and the sort order */
+static unsigned ccol         = 1;
+static unsigned sort_column  = 0;
+static bool sort_descending  = false;
+
 
 static unsigned first_offset (void);
 
@@ -245,6 +281,97 @@ static char * sprintf_summary_records (unsigned rssize, unsigned items_per_page,
 }
 
 
+/* Forget the formatted page (it is formatted again at next paint) */
+static void forget_page (void)
+{
+  argsclear (page);
+  safefree (page_columns);
+  page         = NULL;
+  page_columns = NULL;
+  page_offset  = 0;
+}
+
+
+/* Forget what is on the screen and the formatted page (everything is painted again) */
+static void forget_screen (unsigned rows)
+{
+  unsigned i;
+
+  for (i = 0; i < painted_rows; i ++)
+    safefree (painted [i]);
+  safefree (painted);
+  safefree (painted_attr);
+
+  painted_rows = rows;
+  painted      = rows ? calloc (rows, sizeof (char *)) : NULL;
+  painted_attr = rows ? calloc (rows, sizeof (int)) : NULL;
+
+  forget_page ();
+}
+
+
+/* Paint [text] with [attr] at screen [row], unless it is already there (clipped to [cols] columns) */
+static void paint (unsigned row, char * text, int attr, unsigned cols)
+{
+  size_t len;
+
+  if (row >= painted_rows)
+    return;
+
+  if (! text)
+    text = "";
+
+  if (painted [row] && painted_attr [row] == attr && ! strcmp (painted [row], text))
+    return;
+
+  /* Never wrap to the next screen row */
+  len = osh_strclip (text, strlen (text), cols, NULL);
+
+  attron (attr);
+  mvaddnstr (row, 0, text, len);
+  attroff (attr);
+  clrtoeol ();
+
+  safefree (painted [row]);
+  painted [row]      = strdup (text);
+  painted_attr [row] = attr;
+}
+
+
+/* Read a line of input after [prompt] on the input row (an empty line keeps the previous value of [buf]) */
+static bool read_input (char * prompt, char * buf, unsigned size)
+{
+  char line [MAXLINE] = "";
+  int rc;
+
+  mvaddstr (INPUT_ROW, 0, prompt);
+  clrtoeol ();
+
+  echo ();
+  rc = getnstr (line, RMIN (size, sizeof (line)) - 1);
+  noecho ();
+
+  /* The input row has to be painted again */
+  if (INPUT_ROW < painted_rows)
+    {
+      safefree (painted [INPUT_ROW]);
+      painted [INPUT_ROW] = NULL;
+    }
+
+  /* Do not miss a resize while reading */
+  if (winched)
+    ungetch (KEY_RESIZE);
+
+  if (rc == ERR)
+    return false;
+
+  if (* line)
+    strcpy (buf, line);
+
+  return * buf;
+}
+
+
 /* Define and display the information in the heading */
 static void display_heading (char * progname, char * version, char * tnsname, char * user,             /* 1-st row */
 			     char * query,                                                             /* 2-nd row */
@@ -255,69 +382,87 @@ static void display_heading (char * progname, char * version, char * tnsname, ch
   current_row = 0;
 
   /* 1-st row - Software && Current Time */
-  mvaddstr (current_row ++, 0, l_and_r (sprintf_left_banner (progname, version, tnsname, user), sprintf_right_banner (), cols - 1));
+  paint (current_row ++, l_and_r (sprintf_left_banner (progname, version, tnsname, user), sprintf_right_banner (), cols - 1), A_NORMAL, cols);
 
   /* 2-nd row - Query */
-  attron (A_BOLD);
-  mvaddstr (current_row ++, 0, sprintf_summary_query (query));
-  attroff (A_BOLD);
+  paint (current_row ++, sprintf_summary_query (query), A_BOLD, cols);
 
   /* 3-rd row - Sizes */
-  mvaddstr (current_row ++, 0, sprintf_summary_records (rssize, pagesize - 1, offset, cursor, rows, cols));
+  paint (current_row ++, sprintf_summary_records (rssize, pagesize - 1, offset, cursor, rows, cols), A_NORMAL, cols);
 
-  current_row ++;
+  /* 4-th row - Messages for the user */
+  paint (current_row ++, status, A_NORMAL, cols);
 }
 
 
-/* Show all lines in [argv] until there is space left on the window */
-static char ** display_lines (char * argv [], unsigned pagesize, unsigned cursor)
+/*
+ * Show all lines in [argv] until there is space left on the window and blank the others.
+ *
+ * When scrolled horizontally, each line is sliced at the column offsets
+ * evaluated while formatting: the frozen columns, then those from [hcol].
+ */
+static void display_lines (char * argv [], size_t * offsets, unsigned ncols, unsigned pagesize, unsigned cursor, unsigned rows, unsigned cols)
 {
-  char ** lines = argv;
-  unsigned count = 0;
+  osh_buf_t line = { NULL, 0, 0 };
+  unsigned count;
 
-  while (argv && * argv && pagesize --)
+  /* First item always in Bold (column names) */
+  for (count = 0; argv && argv [count] && count < pagesize; count ++)
     {
-      /* First item always in Bold (column names) */
-      if (count == 0)
-	attron (A_BOLD);
-      else if (count == cursor)
-	attron (A_REVERSE);
+      char * text = argv [count];
 
-      /* Print current line content */
-      mvaddstr (current_row ++, 0, * argv ++);
+      if (offsets && hcol > FROZEN_COLUMNS && hcol < ncols)
+	{
+	  size_t * off = offsets + count * (ncols + 1);
 
-      count ++;
+	  osh_buf_reset (& line);
+	  osh_buf_cat (& line, text, off [FROZEN_COLUMNS]);
+	  osh_buf_cat (& line, text + off [hcol], off [ncols] - off [hcol]);
+	  text = line . data;
+	}
 
-      if (count == 1)
-	attroff (A_BOLD);
-      else if (count == cursor + 1)
-	attroff (A_REVERSE);
+      paint (current_row ++, text, count == 0 ? A_BOLD : count == cursor ? A_REVERSE : A_NORMAL, cols);
     }
-  return lines;
+
+  while (current_row < rows)
+    paint (current_row ++, "", A_NORMAL, cols);
+
+  /* Memory cleanup */
+  osh_buf_free (& line);
 }
 
 
-/* Retrieve max [pagesize] records and display them ([cursor] in bold) */
-static void print_current_page (char * progname, char * version, unsigned rssize, OCI_Resultset * rs,
+/*
+ * Retrieve max [pagesize] records and display them ([cursor] in reverse).
+ *
+ * The page is formatted again only when [offset] changes, and only
+ * the screen lines that differ from what is shown are repainted
+ * (eg. the old and the new cursor lines and the counters).
+ */
+static void print_current_page (char * progname, char * version, unsigned rssize, osh_pager_t * pager,
 				unsigned pagesize, unsigned offset, unsigned cursor, unsigned rows, unsigned cols)
 {
-  unsigned items_per_page = rows - HEADER_LINES - 1;
-
-  clear ();
+  unsigned items_per_page = pagesize - 1;
 
   /* Show heading (Uptime && Database information) */
-  display_heading (progname, version,
-		   (char *) OCI_GetDatabase (OCI_StatementGetConnection (OCI_ResultsetGetStatement (rs))),
-		   (char *) OCI_GetUserName (OCI_StatementGetConnection (OCI_ResultsetGetStatement (rs))),
-		   (char *) OCI_GetSql (OCI_ResultsetGetStatement (rs)),
+  display_heading (progname, version, pager -> database, pager -> user, pager -> sql,
 		   rssize, pagesize, offset, cursor, rows, cols);
 
   /* Limits # of items in the last page */
   if (is_last_page (offset, rssize, items_per_page))
     items_per_page = rssize - offset + 1;
 
-  /* Retrieve max [pagesize] records and display them ([cursor] in bold) */
-  argsclear (display_lines (rstoargv (rssize, rs, items_per_page, offset), pagesize, cursor));
+  /* Take max [pagesize] records from the cache */
+  if (! page || offset != page_offset)
+    {
+      argsclear (page);
+      safefree (page_columns);
+      page        = pager_lines (pager, offset, items_per_page, & page_columns);
+      page_offset = offset;
+    }
+
+  /* Display them ([cursor] in reverse) */
+  display_lines (page, page_columns, pager -> cols + 1, pagesize, cursor, rows, cols);
 
   /* Move cursor back to line/message area */
   move (INPUT_ROW, 0);
@@ -325,34 +470,205 @@ static void print_current_page (char * progname, char * version, unsigned rssize
 }
 
 
-/* Display a ResulSet in a window under curses control */
-static void do_key (char * progname, char * version, unsigned rssize, OCI_Resultset * rs, unsigned rows, unsigned cols, unsigned pagesize);
-void print_curses (unsigned rssize, OCI_Resultset * rs, unsigned wsize, char * progname, char * version)
+/* Evaluate the max # of rows per page (add 1 in order to include column names) */
+static unsigned eval_pagesize (unsigned rssize, unsigned wsize, unsigned rows)
+{
+  unsigned avail = rows > HEADER_LINES + 2 ? rows - HEADER_LINES : 2;
+
+  return ! wsize ? RMIN (rssize + 1, avail) : RMIN (rssize + 1, RMIN (wsize + 1, avail));
+}
+
+
+/* Move [offset] and [cursor] to show row [row] */
+static void goto_row (unsigned row, unsigned items_per_page, unsigned * offset, unsigned * cursor)
+{
+  * offset = (row - 1) / items_per_page * items_per_page + 1;
+  * cursor = row - * offset + 1;
+}
+
+
+/* Go to the row given in [text] as a row # or as a percentage ("#%") of [rssize] rows */
+static void jump_row (char * text, unsigned rssize, unsigned items_per_page, unsigned * offset, unsigned * cursor)
+{
+  char * end;
+  unsigned long n = strtoul (text, & end, 10);
+  unsigned row;
+
+  if (end == text || (* end && strcmp (end, "%")) || ! rssize)
+    {
+      snprintf (status, sizeof (status), "Invalid row: %s", text);
+      return;
+    }
+
+  /* The scrollable cursor is moved straight to the page of the row, with no fetch in between */
+  if (* end == '%')
+    row = RMIN (n, 100) * rssize / 100;
+  else
+    row = RMIN (n, rssize);
+  row = RMAX (1, row);
+
+  goto_row (row, items_per_page, offset, cursor);
+  snprintf (status, sizeof (status), "Row: %u of %u", row, rssize);
+}
+
+
+/* Search [pattern] after (or before) the row under the cursor and move there */
+static void find_row (osh_pager_t * pager, bool forward, unsigned items_per_page, unsigned * offset, unsigned * cursor)
+{
+  unsigned row;
+
+  if (! * pattern)
+    return;
+
+  row = pager_search (pager, pattern, * offset + * cursor - 1, forward);
+  if (row)
+    goto_row (row, items_per_page, offset, cursor);
+  else
+    snprintf (status, sizeof (status), "Pattern not found: %.*s", (int) sizeof (status) - 32, pattern);
+}
+
+
+/* The shell has its own SIGWINCH handler, so the viewer uses one that just interrupts getch() */
+static void on_winch (int sig)
+{
+  winched = 1;
+}
+
+
+/* Resize curses to the current size of the terminal */
+static void resize_window (void)
+{
+  struct winsize ws;
+
+  winched = 0;
+  if (! ioctl (STDOUT_FILENO, TIOCGWINSZ, & ws) && ws . ws_row && ws . ws_col)
+    resizeterm (ws . ws_row, ws . ws_col);
+}
+
+
+/* Release [pager] and the Statement of its ResultSet, unless it is the one to display [rs] */
+static void release_pager (osh_pager_t * pager, OCI_Resultset * rs)
+{
+  OCI_Resultset * current = pager -> rs;
+
+  pager_free (pager);
+  if (current && current != rs)
+    OCI_StatementFree (OCI_ResultsetGetStatement (current));
+}
+
+
+/*
+ * Sort the rows by the column under the cursor: in memory if they fit,
+ * otherwise executing [sql] again with ORDER BY on the server (in which
+ * case a new pager is returned for the new ResultSet).
+ */
+static osh_pager_t * sort_rows (osh_pager_t * pager, OCI_Resultset * rs, char * sql)
+{
+  char * name         = pager -> names [ccol - 1];
+  char * how          = sort_descending ? "descending" : "ascending";
+  unsigned total      = pager -> total;
+  unsigned pagesize   = pager -> pagesize;
+  OCI_Resultset * old = pager -> rs;
+  OCI_Resultset * sorted;
+
+  if (pager_sort (pager, ccol, sort_descending))
+    {
+      snprintf (status, sizeof (status), "Sorted by %s (%s)", name, how);
+      return pager;
+    }
+
+  /* Rows in memory have no server to ask */
+  if (! old)
+    {
+      snprintf (status, sizeof (status), "Cannot sort by %s", name);
+      return pager;
+    }
+
+  /* Too many rows to be kept in memory: the server sorts them (the current ResultSet is no longer needed) */
+  name = strdup (name);
+  pager_free (pager);
+  sorted = ocilib_sorted (old, sql, ccol, sort_descending);
+  if (sorted)
+    {
+      if (old != rs)
+	OCI_StatementFree (OCI_ResultsetGetStatement (old));
+      snprintf (status, sizeof (status), "Sorted by %s (%s) on the server", name, how);
+    }
+  else
+    snprintf (status, sizeof (status), "Cannot sort by %s", name);
+  free (name);
+
+  return pager_alloc (total, sorted ? sorted : old, pagesize);
+}
+
+
+/* Display either a ResulSet [rs] or [rssize] rows in memory [mem] in a window under curses control */
+static osh_pager_t * do_key (char * progname, char * version, unsigned rssize, osh_pager_t * pager, unsigned rows, unsigned cols, unsigned pagesize, unsigned wsize);
+static void view (unsigned rssize, OCI_Resultset * rs, osh_rows_t * mem, unsigned wsize, char * progname, char * version)
 {
   if (rssize)
     {
+      osh_pager_t * pager;
+      struct sigaction sa;
+      struct sigaction old;
       unsigned pagesize;
       unsigned rows;
       unsigned cols;
 
+      /* Write out pending output before to wait for user input */
+      osh_output_flush ();
+
       initialize_curses ();
       keypad (stdscr, TRUE);
       getmaxyx (stdscr, rows, cols);                                  /* find the boundaries of the screeen */
 
+      /* Catch resizes of the terminal while the viewer is running (no SA_RESTART to interrupt getch) */
+      memset (& sa, 0, sizeof (sa));
+      sa . sa_handler = on_winch;
+      sigemptyset (& sa . sa_mask);
+      sigaction (SIGWINCH, & sa, & old);
+
       /* Evaluate the max # of rows per page (add 1 in order to include column names) */
-      pagesize = ! wsize ? RMIN (rssize + 1, rows - HEADER_LINES) : RMIN (rssize + 1, RMIN (wsize + 1, rows - HEADER_LINES));
+      pagesize = eval_pagesize (rssize, wsize, rows);
+
+      /* Keep the rows around the current page in memory while displaying them */
+      pager = rs ? pager_alloc (rssize, rs, pagesize - 1) : pager_alloc_rows (mem, pagesize - 1);
+      forget_screen (rows);
+      hcol        = FROZEN_COLUMNS;
+      ccol        = 1;
+      sort_column = 0;
 
       /* Display a ResulSet in a window under curses control */
-      do_key (progname, version, rssize, rs, rows, cols, pagesize);
+      pager = do_key (progname, version, rssize, pager, rows, cols, pagesize, wsize);
 
+      forget_screen (0);
+      release_pager (pager, rs);
+      sigaction (SIGWINCH, & old, NULL);
       terminate_curses ();
     }
 }
 
 
+/* Display a ResulSet in a window under curses control */
+void print_curses (unsigned rssize, OCI_Resultset * rs, unsigned wsize, char * progname, char * version)
+{
+  view (rssize, rs, NULL, wsize, progname, version);
+}
+
+
+/* Display rows in memory in a window under curses control (the rows are moved to the viewer) */
+void print_curses_rows (osh_rows_t * rows, unsigned wsize, char * progname, char * version)
+{
+  view (rows -> n, NULL, rows, wsize, progname, version);
+}
+
+
 /* Process keyboard input during the main rendering loop */
-static void do_key (char * progname, char * version, unsigned rssize, OCI_Resultset * rs, unsigned rows, unsigned cols, unsigned pagesize)
+static osh_pager_t * do_key (char * progname, char * version, unsigned rssize, osh_pager_t * pager, unsigned rows, unsigned cols, unsigned pagesize, unsigned wsize)
 {
+  OCI_Resultset * rs = pager -> rs;
+  char * sql  = safedup (pager -> sql);
+  char filter [MAXLINE] = "";
   bool done = false;
   unsigned offset = first_offset ();    /* one-based - always in the range [1 - rssize]   */
   unsigned cursor = first_cursor ();    /* one-based - always in the range [1 - pagesize] */
@@ -366,13 +682,20 @@ static void do_key (char * progname, char * version, unsigned rssize, OCI_Result
       int key;
 
       /* Here is the meat - Display page paging [argv] in max [pagesize] lines per page */
-      print_current_page (progname, version, rssize, rs, pagesize, offset, cursor, rows, cols);
+      print_current_page (progname, version, rssize, pager, pagesize, offset, cursor, rows, cols);
+
+      /* Prefetch the pages around the current one while waiting for the user */
+      pager_prefetch (pager, offset);
 
       /* inner loop to handle user input */
       while (! valid)
 	{
 	  /* get a key and update both [offset] and [cursor] to handle boundaries */
-	  switch (key = getch ())
+	  key = getch ();
+	  if (key != ERR)
+	    * status = 0x00;
+
+	  switch (key)
 	    {
 	      /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
 
@@ -449,6 +772,138 @@ static void do_key (char * progname, char * version, unsigned rssize, OCI_Result
 
 	      /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
 
+	      /* terminal resized */
+	    case ERR:
+	      if (! winched)
+		break;
+	      /* fall through */
+
+	    case KEY_RESIZE:
+	      {
+		unsigned row = offset + cursor - 1;    /* keep the row under the cursor */
+
+		valid = true;
+
+		resize_window ();
+		getmaxyx (stdscr, rows, cols);
+		pagesize       = eval_pagesize (rssize, wsize, rows);
+		items_per_page = pagesize - 1;
+
+		/* Re-layout from the rows already in memory and start again on the page of the cursor */
+		pager_resize (pager, items_per_page);
+		forget_screen (rows);
+		clear ();
+
+		goto_row (row, items_per_page, & offset, & cursor);
+	      }
+	      break;
+
+	      /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+	      /* move to the previous column (scrolling to the left) */
+	    case KEY_LEFT:
+	      valid = true;
+
+	      if (ccol > 1)
+		ccol --;
+	      hcol = RMAX (FROZEN_COLUMNS, ccol);
+	      snprintf (status, sizeof (status), "Column: %s", pager -> names [ccol - 1]);
+	      break;
+
+	      /* move to the next column (scrolling to the right) */
+	    case KEY_RIGHT:
+	      valid = true;
+
+	      if (ccol < pager -> cols)
+		ccol ++;
+	      hcol = RMAX (FROZEN_COLUMNS, ccol);
+	      snprintf (status, sizeof (status), "Column: %s", pager -> names [ccol - 1]);
+	      break;
+
+	      /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+	      /* sort by the current column (again to reverse the order) */
+	    case KEY_SORT:
+	      valid = true;
+
+	      sort_descending = sort_column == ccol ? ! sort_descending : false;
+	      sort_column     = ccol;
+
+	      pager  = sort_rows (pager, rs, sql);
+	      rssize = pager -> rssize;
+	      offset = first_offset ();
+	      cursor = first_cursor ();
+	      forget_page ();
+	      break;
+
+	      /* show only the rows matching a pattern (an empty one shows all) */
+	    case KEY_FILTER:
+	      valid = true;
+
+	      * filter = 0x00;
+	      read_input ("&", filter, sizeof (filter));
+	      if (! pager_filter (pager, filter))
+		snprintf (status, sizeof (status), "Too many rows to filter in memory");
+	      else if (! pager -> rssize)
+		{
+		  pager_filter (pager, NULL);
+		  snprintf (status, sizeof (status), "No rows match: %.*s", (int) sizeof (status) - 32, filter);
+		}
+	      else if (* filter)
+		snprintf (status, sizeof (status), "Rows matching %.*s: %u of %u", (int) sizeof (status) - 64, filter, pager -> rssize, pager -> total);
+
+	      rssize = pager -> rssize;
+	      offset = first_offset ();
+	      cursor = first_cursor ();
+	      forget_page ();
+	      break;
+
+	      /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+	      /* search forward */
+	    case KEY_PATTERN:
+	      valid = true;
+
+	      if (read_input ("/", pattern, sizeof (pattern)))
+		find_row (pager, true, items_per_page, & offset, & cursor);
+	      break;
+
+	      /* next match */
+	    case KEY_MATCH:
+	      valid = true;
+
+	      find_row (pager, true, items_per_page, & offset, & cursor);
+	      break;
+
+	      /* previous match */
+	    case KEY_RMATCH:
+	      valid = true;
+
+	      find_row (pager, false, items_per_page, & offset, & cursor);
+	      break;
+
+	      /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+	      /* go to a row typed directly (a digit starts the input) */
+	    case '0': case '1': case '2': case '3': case '4':
+	    case '5': case '6': case '7': case '8': case '9':
+	      ungetch (key);
+	      /* fall through */
+
+	      /* go to row # (or to # % of the rows) */
+	    case KEY_JUMP:
+	      {
+		char where [32] = "";
+
+		valid = true;
+
+		if (read_input (":", where, sizeof (where)))
+		  jump_row (where, rssize, items_per_page, & offset, & cursor);
+	      }
+	      break;
+
+	      /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
 	    case KEY_QUIT:                      /* adios */
 	    case KEY_ESC:                       /* adios */
 	      valid = true;                     /* exit from user input loop */
@@ -465,4 +920,153 @@ static void do_key (char * progname, char * version, unsigned rssize, OCI_Result
   move (rows - 1, 0);
   clrtoeol ();
   refresh ();
+
+  free (sql);
+
+  return pager;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* Highlight the cells marked in [marks] of [line] already painted at screen [row] */
+static void highlight_cells (unsigned row, char * line, size_t * offsets, bool * marks, unsigned ncols, unsigned cols)
+{
+  unsigned c;
+
+  for (c = 0; c < ncols; c ++)
+    if (marks [c])
+      {
+	size_t start = offsets [c + 1] + 1;
+	size_t end   = c + 1 < ncols ? offsets [c + 2] : offsets [ncols + 1] - 1;
+	unsigned x   = osh_strwidth (line, start);
+	unsigned w   = osh_strwidth (line + start, end - start);
+
+	if (x < cols)
+	  mvchgat (row, x, RMIN (w, cols - x), A_REVERSE, 0, NULL);
+      }
+
+  /* Paint the line again at next run in order to remove the highlights */
+  safefree (painted [row]);
+  painted [row] = NULL;
+}
+
+
+/*
+ * Execute again the Statement of [rs] every [seconds] and display its
+ * first rows (max [wsize] if not 0) in a window until the user quits,
+ * highlighting the cells changed since the previous run.  Only the
+ * lines that changed are painted again.  Any other key runs it now.
+ */
+void watch_curses (OCI_Resultset * rs, unsigned wsize, unsigned seconds, char * progname, char * version)
+{
+  unsigned ncols   = OCI_GetColumnCount (rs);
+  char * tnsname   = (char *) OCI_GetDatabase (OCI_StatementGetConnection (OCI_ResultsetGetStatement (rs)));
+  char * user      = (char *) OCI_GetUserName (OCI_StatementGetConnection (OCI_ResultsetGetStatement (rs)));
+  char * sql       = (char *) OCI_GetSql (OCI_ResultsetGetStatement (rs));
+  char ** before   = NULL;
+  unsigned brows   = 0;
+  unsigned run     = 0;
+  bool done        = false;
+  struct sigaction sa;
+  struct sigaction old;
+  unsigned rows;
+  unsigned cols;
+
+  /* Write out pending output before to wait for user input */
+  osh_output_flush ();
+
+  initialize_curses ();
+  keypad (stdscr, TRUE);
+  getmaxyx (stdscr, rows, cols);
+
+  /* Catch resizes of the terminal while the viewer is running (no SA_RESTART to interrupt getch) */
+  memset (& sa, 0, sizeof (sa));
+  sa . sa_handler = on_winch;
+  sigemptyset (& sa . sa_mask);
+  sigaction (SIGWINCH, & sa, & old);
+
+  forget_screen (rows);
+  * status = 0x00;
+
+  /* Wait at most [seconds] for a key */
+  timeout (seconds * 1000);
+
+  while (rs && ! done)
+    {
+      unsigned avail = rows > HEADER_LINES + 1 ? rows - HEADER_LINES - 1 : 0;
+      unsigned n     = wsize ? RMIN (wsize, avail) : avail;
+      unsigned nrows;
+      char ** now    = watch_snapshot (rs, n, & nrows);
+      bool * marks   = calloc ((size_t) nrows * ncols + 1, sizeof (bool));
+      time_t t       = time (NULL);
+      size_t * offsets;
+      char ** lines;
+      unsigned r;
+
+      watch_diff (before, brows, now, nrows, ncols, marks);
+      lines = watch_lines (rs, now, nrows, & offsets);
+      run ++;
+
+      /* Heading, then the column names and the rows (changed cells in reverse) */
+      strftime (status, sizeof (status), "Last run: %H:%M:%S", localtime (& t));
+      snprintf (status + strlen (status), sizeof (status) - strlen (status), " - Every %us - Run: %u", seconds, run);
+      display_heading (progname, version, tnsname, user, sql, nrows, nrows + 1, first_offset (), 0, rows, cols);
+
+      for (r = 0; r <= nrows && current_row < rows; r ++, current_row ++)
+	{
+	  paint (current_row, lines [r], r ? A_NORMAL : A_BOLD, cols);
+	  if (r && run > 1 && memchr (marks + (r - 1) * ncols, true, ncols))
+	    highlight_cells (current_row, lines [r], offsets + r * (ncols + 2), marks + (r - 1) * ncols, ncols, cols);
+	}
+      while (current_row < rows)
+	paint (current_row ++, "", A_NORMAL, cols);
+
+      move (INPUT_ROW, 0);
+      refresh ();
+
+      /* Keep this run to be compared with the next one */
+      watch_free (before, brows, ncols);
+      before = now;
+      brows  = nrows;
+
+      /* Memory cleanup */
+      argsclear (lines);
+      free (offsets);
+      free (marks);
+
+      /* Wait for the next run */
+      switch (getch ())
+	{
+	case KEY_QUIT:
+	case KEY_ESC:
+	  done = true;
+	  break;
+
+	case ERR:
+	  if (! winched)
+	    break;
+	  /* fall through */
+
+	case KEY_RESIZE:
+	  resize_window ();
+	  getmaxyx (stdscr, rows, cols);
+	  forget_screen (rows);
+	  clear ();
+	  break;
+	}
+
+      /* Execute again the same statement */
+      if (! done)
+	rs = ocilib_execute_again (rs);
+    }
+
+  /* Memory cleanup */
+  watch_free (before, brows, ncols);
+
+  timeout (-1);
+  forget_screen (0);
+  sigaction (SIGWINCH, & old, NULL);
+  terminate_curses ();
 }
@@ -0,0 +1,194 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* System headers */
+#include <ctype.h>
+
+/* Project headers */
+#include "osh.h"
+
+
+/*
+ * Exact arithmetic on numbers in text (eg. "-123.45"), as they are decoded
+ * by ocilib_value() with all their digits.  The typed keys of numbers are
+ * doubles, which cannot tell apart numbers of more than 15 digits.
+ * Either '.' or ',' is the decimal separator (it depends on NLS settings).
+ */
+
+
+/* A number in text broken down (no leading zeros in the integer part, no trailing zeros in the fractional one) */
+typedef struct
+{
+  bool negative;
+  const char * ip;          /* integer digits                             */
+  size_t ilen;
+  const char * fp;          /* fractional digits                          */
+  size_t flen;
+  char sep;                 /* decimal separator (0 if none)              */
+
+} decimal_t;
+
+
+/* Break down [s] in [d], return false unless it is a plain decimal number (eg. no exponent) */
+static bool parse (const char * s, decimal_t * d)
+{
+  memset (d, 0, sizeof (* d));
+
+  if (! s || ! strpbrk (s, "0123456789"))
+    return false;
+
+  if (* s == '-' || * s == '+')
+    d -> negative = * s ++ == '-';
+
+  while (* s == '0')
+    s ++;
+  d -> ip = s;
+  while (isdigit ((unsigned char) * s))
+    s ++;
+  d -> ilen = s - d -> ip;
+
+  d -> fp = s;
+  if (* s == '.' || * s == ',')
+    {
+      d -> sep = * s ++;
+      d -> fp  = s;
+      while (isdigit ((unsigned char) * s))
+	s ++;
+      d -> flen = s - d -> fp;
+    }
+  if (* s)
+    return false;
+
+  while (d -> flen && d -> fp [d -> flen - 1] == '0')
+    d -> flen --;
+
+  /* Zero has no sign */
+  if (! d -> ilen && ! d -> flen)
+    d -> negative = false;
+
+  return true;
+}
+
+
+/* Compare the absolute values of [a] and [b] */
+static int magnitude (decimal_t * a, decimal_t * b)
+{
+  size_t i;
+  int cmp;
+
+  if (a -> ilen != b -> ilen)
+    return a -> ilen < b -> ilen ? -1 : 1;
+
+  if ((cmp = memcmp (a -> ip, b -> ip, a -> ilen)))
+    return cmp < 0 ? -1 : 1;
+
+  for (i = 0; i < a -> flen || i < b -> flen; i ++)
+    {
+      char x = i < a -> flen ? a -> fp [i] : '0';
+      char y = i < b -> flen ? b -> fp [i] : '0';
+
+      if (x != y)
+	return x < y ? -1 : 1;
+    }
+
+  return 0;
+}
+
+
+/* The digit of [d] at position [k] (1 for the units, 0 for the first fractional digit, -1 for the second, ...) */
+static int digit (decimal_t * d, long k)
+{
+  if (k > 0)
+    return k <= (long) d -> ilen ? d -> ip [d -> ilen - k] - '0' : 0;
+
+  return - k < (long) d -> flen ? d -> fp [- k] - '0' : 0;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* Compare the numbers [a] and [b] in [cmp], return false if either is not a plain decimal number */
+bool osh_decimal_cmp (const char * a, const char * b, int * cmp)
+{
+  decimal_t x;
+  decimal_t y;
+
+  if (! parse (a, & x) || ! parse (b, & y))
+    return false;
+
+  if (x . negative != y . negative)
+    * cmp = x . negative ? -1 : 1;
+  else
+    * cmp = (x . negative ? -1 : 1) * magnitude (& x, & y);
+
+  return true;
+}
+
+
+/* Return the exact sum of the numbers [a] and [b] (to be freed), NULL if either is not a plain decimal number */
+char * osh_decimal_add (const char * a, const char * b)
+{
+  decimal_t x;
+  decimal_t y;
+  decimal_t * big;
+  decimal_t * small;
+  bool subtract;
+  size_t ilen;
+  size_t flen;
+  char * digits;
+  char * sum;
+  char * s;
+  size_t i;
+  long k;
+  int carry = 0;
+
+  if (! parse (a, & x) || ! parse (b, & y))
+    return NULL;
+
+  /* With opposite signs the smaller absolute value is subtracted from the bigger one, which gives the sign */
+  subtract = x . negative != y . negative;
+  big      = subtract && magnitude (& x, & y) < 0 ? & y : & x;
+  small    = big == & x ? & y : & x;
+
+  ilen   = RMAX (x . ilen, y . ilen) + 1;
+  flen   = RMAX (x . flen, y . flen);
+  digits = calloc (ilen + flen + 1, 1);
+
+  /* From the least significant digit, most significant first in [digits] */
+  for (k = 1 - (long) flen; k <= (long) ilen; k ++)
+    {
+      int d = subtract ? digit (big, k) - digit (small, k) - carry : digit (big, k) + digit (small, k) + carry;
+
+      carry = subtract ? d < 0 : d > 9;
+      digits [ilen - k] = '0' + (subtract ? (d + 10) % 10 : d % 10);
+    }
+
+  /* Drop the leading zeros of the integer part (but the units) and the trailing zeros of the fractional one */
+  for (i = 0; i + 1 < ilen && digits [i] == '0'; i ++)
+    ;
+  while (flen && digits [ilen + flen - 1] == '0')
+    flen --;
+
+  sum = s = calloc (ilen - i + flen + 3, 1);
+  if (big -> negative && (ilen - i > 1 || digits [i] != '0' || flen))
+    * s ++ = '-';
+  memcpy (s, digits + i, ilen - i);
+  s += ilen - i;
+  if (flen)
+    {
+      * s ++ = x . sep ? x . sep : y . sep ? y . sep : '.';
+      memcpy (s, digits + ilen, flen);
+    }
+
+  free (digits);
+
+  return sum;
+}
@@ -29,7 +29,10 @@ enum
   OPT_HELP   = 'h',
   OPT_QUIET  = 'q',
 
-  OPT_RELOAD = 'f'
+  OPT_RELOAD = 'f',
+
+  /* Timing */
+  OPT_TIMING = 'k'
 };
 
 
@@ -42,6 +45,9 @@ static struct option lopts [] =
 
   { "reload", no_argument, NULL, OPT_RELOAD },
 
+  /* Timing */
+  { "timing", no_argument, NULL, OPT_TIMING },
+
   { NULL,     0,           NULL, 0          }
 };
 
@@ -62,6 +68,7 @@ static void usage (char * progname, struct option * options)
   printf ("\n");
 
   usage_item (options, n, OPT_RELOAD,  "force reload");
+  usage_item (options, n, OPT_TIMING,  "show the client-side timing breakdown");
 }
 
 
@@ -74,6 +81,7 @@ int osh_describe (int argc, char * argv [])
   /* Variables that are set according to the specified options */
   bool quiet      = false;
   bool reload     = false;
+  bool timing     = false;
 
   osh_connection_t * conn;
   char ** names;
@@ -101,6 +109,7 @@ int osh_describe (int argc, char * argv [])
 	case OPT_QUIET: quiet = true;            break;
 
         case OPT_RELOAD:  reload = true;         break;
+        case OPT_TIMING:  timing = true;         break;
 	}
     }
 
@@ -120,9 +129,10 @@ int osh_describe (int argc, char * argv [])
     }
 
   /* Describe tables over current connection */
-  conn = get_current_connection ();
+  conn = get_active_connection ();
 
   /* Do the job */
+  osh_timing_reset ();
   names = ocilib_user_table_names (conn, reload);
   if (! names)
     {
@@ -149,7 +159,7 @@ int osh_describe (int argc, char * argv [])
 
       /* Retrieve [columns] of the given table */
       if (! quiet)
-	printf ("%s: retrieving cols from user table '%s' ... ", progname, name);
+	osh_progress ("%s: retrieving cols from user table '%s' ... ", progname, name);
 
       /* Convert to [name] to uppercase */
       rupper (name);
@@ -170,6 +180,7 @@ int osh_describe (int argc, char * argv [])
 	  unsigned c    = 0;
 	  bool reverse  = false;
 	  osh_column_t * col;
+	  rtime_t t1    = nswall ();
 
 	  /* Print columns */
 	  if (! quiet)
@@ -193,8 +204,12 @@ int osh_describe (int argc, char * argv [])
 		  }
 	      }
 
+	  osh_timing_add (OSH_SPAN_FORMAT, nswall () - t1);
+
 	  /* Print the data */
+	  t1 = nswall ();
 	  mxprint (mx);
+	  osh_timing_add (OSH_SPAN_OUTPUT, nswall () - t1);
 
 	  /* Memory cleanup */
 	  mxfree (mx);
@@ -205,6 +220,10 @@ int osh_describe (int argc, char * argv [])
 	printf ("\n");
     }
 
+  /* Client-side timing breakdown */
+  if (osh_timing_enabled (timing))
+    osh_timing_print (progname);
+
   /* Bye bye! */
   return 0;
 }
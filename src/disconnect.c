@@ -109,7 +109,7 @@ int osh_disconnect (int argc, char * argv [])
       break;
 
     case 1:   /* 1 argument - get given connection */
-      conn = get_connection (atoi (argv [argc - 1]));
+      conn = find_connection (argv [argc - 1]);
       if (! conn)
 	{
 	  if (! quiet)
@@ -126,7 +126,7 @@ int osh_disconnect (int argc, char * argv [])
     }
 
   if (! quiet)
-    printf ("%s: disconnecting from database '%s' ... ", progname, osh_connection_name (conn));
+    osh_progress ("%s: disconnecting from database '%s' ... ", progname, osh_connection_name (conn));
 
   /* Disconnect */
   conn -> handle = ocilib_disconnect (conn -> handle);
@@ -0,0 +1,491 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* Project headers */
+#include "osh.h"
+#include "ocilib.h"
+
+
+/* Identifiers */
+#define NAME         "each"
+#define BRIEF        "Run a command on many connections concurrently"
+#define SYNOPSIS     "each [options] -- select|tables|oping|describe [args]"
+#define DESCRIPTION  "Runs a command on all the connections (or those matching a tag) in parallel and merges the outputs"
+
+/* Public variable */
+osh_command_t cmd_each = { NAME, BRIEF, SYNOPSIS, DESCRIPTION, osh_each };
+
+/* Default # of connections served at the same time */
+#define DEFAULT_JOBS  8
+
+
+/*
+ * The commands are not run as builtins (they are not reentrant), but
+ * each worker thread does on its own connection what they would do and
+ * keeps the output lines in memory.  Only the shell prints them, either
+ * per connection in the order of the table or as soon as available.
+ */
+
+
+/* The commands that can be run on many connections */
+typedef enum
+{
+  EACH_SELECT,
+  EACH_TABLES,
+  EACH_PING,
+  EACH_DESCRIBE
+
+} each_cmd_t;
+
+
+/* A connection to run the command on */
+typedef struct
+{
+  osh_connection_t * conn;
+  char ** lines;            /* the output (NULL on error)                   */
+  char * error;
+  rtime_t elapsed;
+  bool done;
+  bool printed;
+
+} job_t;
+
+
+/* The connections being served by a pool of threads */
+typedef struct
+{
+  pthread_mutex_t lock;
+  pthread_cond_t changed;   /* a job has been done                          */
+
+  job_t * jobs;
+  unsigned n;
+  unsigned next;            /* next job to run                              */
+  unsigned left;            /* jobs not yet done                            */
+  bool stop;                /* do not run other jobs                        */
+
+  /* What to run */
+  each_cmd_t cmd;
+  char * arg;               /* the query or the table name                  */
+
+} broadcast_t;
+
+
+static bool interrupted = false;
+static broadcast_t * running = NULL;
+
+
+/* What to do on ^C */
+static void on_ctrl_c (int signo)
+{
+  interrupted = true;
+  if (running)
+    running -> stop = true;
+}
+
+
+/* GNU short options */
+enum
+{
+  /* Startup */
+  OPT_HELP       = 'h',
+  OPT_QUIET      = 'q',
+
+  /* Connections */
+  OPT_TAG        = 'T',
+  OPT_JOBS       = 'j',
+
+  /* Output */
+  OPT_INTERLEAVE = 'i'
+};
+
+
+/* GNU long options */
+static struct option lopts [] =
+{
+  /* Startup */
+  { "help",       no_argument,       NULL, OPT_HELP       },
+  { "quiet",      no_argument,       NULL, OPT_QUIET      },
+
+  /* Connections */
+  { "tag",        required_argument, NULL, OPT_TAG        },
+  { "jobs",       required_argument, NULL, OPT_JOBS       },
+
+  /* Output */
+  { "interleave", no_argument,       NULL, OPT_INTERLEAVE },
+
+  { NULL,         0,                 NULL, 0              }
+};
+
+
+/* Display the syntax */
+static void usage (char * progname, struct option * options)
+{
+  /* longest option name */
+  unsigned n = optmax (options);
+
+  printf ("%s, %s\n", progname, NAME);
+  printf ("Usage: %s [options] -- select|tables|oping|describe [args]\n", progname);
+  printf ("\n");
+
+  printf ("Startup:\n");
+  usage_item (options, n, OPT_HELP,       "show this help message and exit");
+  usage_item (options, n, OPT_QUIET,      "run quietly");
+  printf ("\n");
+
+  printf ("Connections:\n");
+  usage_item (options, n, OPT_TAG,        "only the connections whose tag or TNS name matches a shell pattern");
+  usage_item (options, n, OPT_JOBS,       "# of connections served at the same time (default 8)");
+  printf ("\n");
+
+  printf ("Output:\n");
+  usage_item (options, n, OPT_INTERLEAVE, "print as soon as available, each line prefixed by the connection");
+}
+
+
+/* Lookup for a command by name */
+static int each_lookup (char * name)
+{
+  if (! strcmp (name, "select"))
+    return EACH_SELECT;
+  if (! strcmp (name, "tables"))
+    return EACH_TABLES;
+  if (! strcmp (name, "oping"))
+    return EACH_PING;
+  if (! strcmp (name, "describe"))
+    return EACH_DESCRIBE;
+  return -1;
+}
+
+
+/* Run the command of [batch] on the connection of [job] */
+static void run_job (broadcast_t * batch, job_t * job)
+{
+  osh_connection_t * conn = job -> conn;
+  osh_connection_t * session;
+  OCI_Resultset * rs;
+  char ** names;
+  char line [128];
+  rtime_t t1;
+
+  /* A session of the pool if any, so the other jobs on [conn] do not wait */
+  if (! (session = ocilib_borrow (conn)))
+    {
+      job -> error = strdup ("cannot connect");
+      return;
+    }
+  t1 = nswall ();
+
+  switch (batch -> cmd)
+    {
+    case EACH_SELECT:
+      rs = ocilib_scrollable_resultset (session, batch -> arg);
+      if (rs)
+	{
+	  unsigned rssize = rs_size (rs);
+
+	  job -> lines = rssize ? rstoargv (rssize, rs, 0, 0) : argsmore (NULL, "no data to display");
+
+	  /* Free the statement and all resources associated to it */
+	  OCI_StatementFree (OCI_ResultsetGetStatement (rs));
+	}
+      break;
+
+    case EACH_TABLES:
+      /* A copy, the names are cached by the connection */
+      for (names = ocilib_user_table_names (conn, false); names && * names; names ++)
+	job -> lines = argsmore (job -> lines, * names);
+      if (! job -> lines && ! osh_connection_error (conn))
+	job -> lines = argsmore (NULL, "no tables");
+      break;
+
+    case EACH_PING:
+      if (OCI_Ping (session -> handle))
+	{
+	  rtime_t elapsed = nswall () - t1;
+
+	  snprintf (line, sizeof (line), "reply from %s: time=%.3f ms", OCI_GetDatabase (session -> handle), elapsed / 1e6);
+	  job -> lines = argsmore (NULL, line);
+	}
+      else
+	osh_set_error (session, "Cannot ping");
+      break;
+
+    case EACH_DESCRIBE:
+      job -> lines = ocilib_column_names (session, batch -> arg);
+      break;
+    }
+
+  job -> elapsed = nswall () - t1;
+  ocilib_giveback (conn, session);
+  if (! job -> lines)
+    job -> error = safedup (osh_connection_error (conn) ? osh_connection_error (conn) : "failed");
+
+  conn -> used = nswall ();
+}
+
+
+/* A worker thread: take the next job until none is left */
+static void * serve_jobs (void * arg)
+{
+  broadcast_t * batch = arg;
+
+  pthread_mutex_lock (& batch -> lock);
+  while (batch -> next < batch -> n)
+    {
+      job_t * job = & batch -> jobs [batch -> next ++];
+
+      if (! batch -> stop)
+	{
+	  pthread_mutex_unlock (& batch -> lock);
+	  run_job (batch, job);
+	  pthread_mutex_lock (& batch -> lock);
+	}
+      else
+	job -> error = strdup ("interrupted");
+
+      job -> done = true;
+      batch -> left --;
+      pthread_cond_signal (& batch -> changed);
+    }
+  pthread_mutex_unlock (& batch -> lock);
+
+  return NULL;
+}
+
+
+/* Print the output of [job] (called by the shell only) */
+static void print_job (job_t * job, bool interleave)
+{
+  char * name = osh_connection_name (job -> conn);
+  char ** line;
+
+  if (interleave)
+    {
+      if (job -> error)
+	printf ("%s: Error! %s\n", name, job -> error);
+      for (line = job -> lines; line && * line; line ++)
+	printf ("%s: %s\n", name, * line);
+    }
+  else
+    {
+      printf ("#%u %s (%s)", job -> conn -> id, name, osh_connection_user (job -> conn) ? osh_connection_user (job -> conn) : "wallet");
+      if (job -> error)
+	printf (" - Error! %s\n", job -> error);
+      else
+	printf (" - %u lines in %s\n", argslen (job -> lines), ns2a (job -> elapsed));
+      for (line = job -> lines; line && * line; line ++)
+	printf ("%s\n", * line);
+      printf ("\n");
+    }
+
+  job -> printed = true;
+}
+
+
+/* Run the command on all the connections in [batch] with [jobs] threads and print the outputs; return the # of failures */
+static unsigned broadcast (broadcast_t * batch, unsigned jobs, bool interleave)
+{
+  pthread_t * tids = calloc (jobs, sizeof (pthread_t));
+  bool * started   = calloc (jobs, sizeof (bool));
+  unsigned first   = 0;             /* first job not yet printed in order */
+  unsigned failed  = 0;
+  unsigned i;
+
+  pthread_mutex_init (& batch -> lock, NULL);
+  pthread_cond_init (& batch -> changed, NULL);
+  batch -> left = batch -> n;
+
+  for (i = 0; i < jobs; i ++)
+    started [i] = ! pthread_create (& tids [i], NULL, serve_jobs, batch);
+
+  /* The shell serves the jobs on its own if no thread can be started */
+  if (! memchr (started, true, jobs))
+    serve_jobs (batch);
+
+  /* Print the outputs as they are available */
+  pthread_mutex_lock (& batch -> lock);
+  for (;;)
+    {
+      for (i = 0; i < batch -> n; i ++)
+	if (batch -> jobs [i] . done && ! batch -> jobs [i] . printed && (interleave || i == first))
+	  {
+	    job_t * job = & batch -> jobs [i];
+
+	    pthread_mutex_unlock (& batch -> lock);
+	    print_job (job, interleave);
+	    osh_output_flush ();
+	    pthread_mutex_lock (& batch -> lock);
+
+	    failed += job -> error != NULL;
+	    while (first < batch -> n && batch -> jobs [first] . printed)
+	      first ++;
+	  }
+
+      if (! batch -> left && first == batch -> n)
+	break;
+      if (batch -> left)
+	pthread_cond_wait (& batch -> changed, & batch -> lock);
+    }
+  pthread_mutex_unlock (& batch -> lock);
+
+  for (i = 0; i < jobs; i ++)
+    if (started [i])
+      pthread_join (tids [i], NULL);
+
+  /* Memory cleanup */
+  pthread_mutex_destroy (& batch -> lock);
+  pthread_cond_destroy (& batch -> changed);
+  free (started);
+  free (tids);
+
+  return failed;
+}
+
+
+/* The [each] command */
+int osh_each (int argc, char * argv [])
+{
+  char * progname = basename (argv [0]);
+  char * sopts    = optlegitimate (lopts);
+  char * plus;
+
+  /* Variables that are set according to the specified options */
+  bool quiet      = false;
+  char * tag      = NULL;
+  unsigned jobs   = DEFAULT_JOBS;
+  bool interleave = false;
+
+  broadcast_t batch;
+  int cmd;
+  unsigned failed;
+  unsigned i;
+
+  /* signal handler */
+  void (* on_prev) (int);
+
+  int option;
+
+  /* Lookup for the command in the static table of registered extensions */
+  if (! cmd_by_name (progname))
+    {
+      printf ("%s: Command [%s] not found.\n", progname, progname);
+      return 1;
+    }
+
+  /* Stop at the first non-option argument (the command to run) */
+  plus = calloc (strlen (sopts) + 2, 1);
+  plus [0] = '+';
+  strcpy (plus + 1, sopts);
+
+  /* Parse command line options */
+  optind = 0;
+  optarg = NULL;
+  argv [0] = progname;
+  while ((option = getopt_long (argc, argv, plus, lopts, NULL)) != -1)
+    {
+      switch (option)
+	{
+	default: if (! quiet) printf ("Try '%s --help' for more information.\n", progname); free (plus); return 1;
+
+	  /* Startup */
+	case OPT_HELP:       usage (progname, lopts); free (plus); return 0;
+	case OPT_QUIET:      quiet = true;                         break;
+
+	  /* Connections */
+	case OPT_TAG:        tag = optarg;                         break;
+	case OPT_JOBS:       jobs = RMAX (1, atoi (optarg));       break;
+
+	  /* Output */
+	case OPT_INTERLEAVE: interleave = true;                    break;
+	}
+    }
+  free (plus);
+
+  /* The command to run */
+  if (optind == argc)
+    {
+      if (! quiet)
+	printf ("%s: missing command\n", progname);
+      return 1;
+    }
+
+  if ((cmd = each_lookup (argv [optind])) == -1)
+    {
+      if (! quiet)
+	printf ("%s: Command [%s] cannot be run on many connections (only select, tables, oping, describe)\n", progname, argv [optind]);
+      return 1;
+    }
+
+  if ((cmd == EACH_SELECT || cmd == EACH_DESCRIBE) && optind + 1 == argc)
+    {
+      if (! quiet)
+	printf ("%s: %s: Too few arguments\n", progname, argv [optind]);
+      return 1;
+    }
+
+  /* Check # of connections */
+  if (! len_connections ())
+    {
+      if (! quiet)
+	printf ("%s: no connection.\n", progname);
+      return 0;
+    }
+
+  memset (& batch, 0, sizeof (batch));
+  batch . cmd = cmd;
+  /* The query includes its [select] keyword */
+  if (cmd == EACH_SELECT)
+    batch . arg = argsjoin (argv + optind);
+  else if (cmd == EACH_DESCRIBE)
+    batch . arg = strdup (argv [optind + 1]);
+
+  /* The matching connections in the order of the table */
+  batch . jobs = calloc (len_connections () + 1, sizeof (job_t));
+  for (i = 0; i < len_connections (); i ++)
+    if (osh_connection_matches (get_connections () [i], tag))
+      batch . jobs [batch . n ++] . conn = get_connections () [i];
+
+  if (! batch . n)
+    {
+      if (! quiet)
+	printf ("%s: no connection matching [%s]\n", progname, tag);
+      safefree (batch . arg);
+      free (batch . jobs);
+      return 1;
+    }
+
+  /* Enable ^C (the running jobs are completed, the others are skipped) */
+  on_prev = signal (SIGINT, on_ctrl_c);
+  running = & batch;
+
+  osh_timing_reset ();
+  failed = broadcast (& batch, RMIN (jobs, batch . n), interleave);
+
+  running = NULL;
+  interrupted = false;
+
+  /* Re-enable ^C to its previous handler */
+  signal (SIGINT, on_prev);
+
+  if (! quiet)
+    printf ("%s: #%u connections - #%u failed\n", progname, batch . n, failed);
+
+  /* Memory cleanup */
+  for (i = 0; i < batch . n; i ++)
+    {
+      argsclear (batch . jobs [i] . lines);
+      safefree (batch . jobs [i] . error);
+    }
+  free (batch . jobs);
+  safefree (batch . arg);
+
+  /* Bye bye! */
+  return failed ? 1 : 0;
+}
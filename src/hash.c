@@ -0,0 +1,38 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* Project headers */
+#include "osh.h"
+
+
+/*
+ * FNV-1a hashing for the hash tables in memory (connections, watch mode,
+ * groups of xselect).  A hash can be computed across many pieces of data
+ * by passing the hash of the previous ones (OSH_HASH_INIT the first time).
+ */
+
+
+/* Continue hash [h] with the [len] bytes of [data] */
+unsigned osh_hash (const void * data, size_t len, unsigned h)
+{
+  const unsigned char * p = data;
+
+  while (len --)
+    h = (h ^ * p ++) * 16777619u;
+
+  return h;
+}
+
+
+/* Hash of the string [s] (NULL is hashed as the empty string) */
+unsigned osh_strhash (const char * s)
+{
+  return s ? osh_hash (s, strlen (s), OSH_HASH_INIT) : OSH_HASH_INIT;
+}
@@ -70,11 +70,14 @@ void osh_init (char * progname, int quiet)
       xprintf ("Type 'help' for the list of builtin extensions implemented by this shell.\n\n");
     }
 
+  /* The health monitor is stopped only when the shell exits */
+  atexit (osh_monitor_stop);
+
   /* Ignore writes to connections that have been closed at the other end */
   signal (SIGPIPE, SIG_IGN);
 
-  /* Set unbuffered stdout */
-  setvbuf (stdout, NULL, _IONBF, 0);
+  /* Buffer stdout (the output of each builtin is flushed when it returns) */
+  osh_output_init ();
 
   /* Set the $osh variable */
   set_variable (OSH_PACKAGE, OSH_VERSION);
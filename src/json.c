@@ -0,0 +1,231 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* System headers */
+#include <math.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Project headers */
+#include "osh.h"
+
+
+/* Return the offset of the first byte in [s] that must be escaped ([len] if none) */
+static size_t json_clean (const unsigned char * s, size_t len)
+{
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  /* 32 bytes at a time: look for '"', '\' and control characters (unsigned min (x, 0x1f) == x) */
+  const __m256i quote = _mm256_set1_epi8 ('"');
+  const __m256i slash = _mm256_set1_epi8 ('\\');
+  const __m256i ctrl  = _mm256_set1_epi8 (0x1f);
+
+  for (; i + 32 <= len; i += 32)
+    {
+      __m256i x = _mm256_loadu_si256 ((const __m256i *) (s + i));
+      __m256i m = _mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8 (x, quote), _mm256_cmpeq_epi8 (x, slash)),
+				   _mm256_cmpeq_epi8 (_mm256_min_epu8 (x, ctrl), x));
+      unsigned mask = _mm256_movemask_epi8 (m);
+      if (mask)
+	return i + __builtin_ctz (mask);
+    }
+#endif
+
+#if defined(__SSE2__)
+  /* 16 bytes at a time */
+  {
+    const __m128i quote = _mm_set1_epi8 ('"');
+    const __m128i slash = _mm_set1_epi8 ('\\');
+    const __m128i ctrl  = _mm_set1_epi8 (0x1f);
+
+    for (; i + 16 <= len; i += 16)
+      {
+	__m128i x = _mm_loadu_si128 ((const __m128i *) (s + i));
+	__m128i m = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (x, quote), _mm_cmpeq_epi8 (x, slash)),
+				  _mm_cmpeq_epi8 (_mm_min_epu8 (x, ctrl), x));
+	unsigned mask = _mm_movemask_epi8 (m);
+	if (mask)
+	  return i + __builtin_ctz (mask);
+      }
+  }
+#endif
+
+  /* Scalar tail (or fallback) */
+  for (; i < len; i ++)
+    if (s [i] < 0x20 || s [i] == '"' || s [i] == '\\')
+      return i;
+
+  return len;
+}
+
+
+/* Append [len] bytes of [s] as a quoted JSON string, copying clean runs in bulk */
+void json_string (osh_buf_t * buf, const char * s, size_t len)
+{
+  static const char hex [] = "0123456789abcdef";
+
+  osh_buf_cat (buf, "\"", 1);
+  while (len)
+    {
+      size_t n = json_clean ((const unsigned char *) s, len);
+      char esc [7];
+
+      osh_buf_cat (buf, s, n);
+      s   += n;
+      len -= n;
+      if (! len)
+	break;
+
+      switch (* s)
+	{
+	case '"':  osh_buf_cat (buf, "\\\"", 2); break;
+	case '\\': osh_buf_cat (buf, "\\\\", 2); break;
+	case '\b': osh_buf_cat (buf, "\\b", 2);  break;
+	case '\f': osh_buf_cat (buf, "\\f", 2);  break;
+	case '\n': osh_buf_cat (buf, "\\n", 2);  break;
+	case '\r': osh_buf_cat (buf, "\\r", 2);  break;
+	case '\t': osh_buf_cat (buf, "\\t", 2);  break;
+	default:
+	  memcpy (esc, "\\u00", 4);
+	  esc [4] = hex [(* s >> 4) & 0x0f];
+	  esc [5] = hex [* s & 0x0f];
+	  osh_buf_cat (buf, esc, 6);
+	  break;
+	}
+      s ++;
+      len --;
+    }
+  osh_buf_cat (buf, "\"", 1);
+}
+
+
+/* Append an integer */
+void json_integer (osh_buf_t * buf, long long value)
+{
+  char digits [24];
+  char * p = digits + sizeof (digits);
+  unsigned long long v = value < 0 ? - (unsigned long long) value : (unsigned long long) value;
+
+  do
+    * -- p = '0' + v % 10;
+  while (v /= 10);
+
+  if (value < 0)
+    * -- p = '-';
+
+  osh_buf_cat (buf, p, digits + sizeof (digits) - p);
+}
+
+
+/* Append a floating point number (integral values are written as integers, infinities and NaNs as null) */
+void json_double (osh_buf_t * buf, double value)
+{
+  char text [32];
+  int n;
+
+  if (! isfinite (value))
+    {
+      osh_buf_cat (buf, "null", 4);
+      return;
+    }
+
+  if (value > -1e15 && value < 1e15 && value == (double) (long long) value)
+    {
+      json_integer (buf, (long long) value);
+      return;
+    }
+
+  /* The shortest text that reads back as the same value */
+  n = snprintf (text, sizeof (text), "%.15g", value);
+  if (strtod (text, NULL) != value)
+    n = snprintf (text, sizeof (text), "%.17g", value);
+
+  osh_buf_cat (buf, text, n);
+}
+
+
+/*
+ * Append a number given in [text] with all its digits (eg. a NUMBER decoded
+ * by the library), exactly.  Anything else than a plain decimal number
+ * is written as a floating point number (eg. with an exponent), or as
+ * null if it is not a number at all (eg. "~" for an infinity).
+ */
+void json_number (osh_buf_t * buf, const char * text)
+{
+  const char * s = text;
+  const char * ip;
+  const char * fp = NULL;
+  char * end;
+  double value;
+  size_t ilen;
+  size_t flen     = 0;
+  bool negative   = * s == '-';
+
+  if (* s == '-' || * s == '+')
+    s ++;
+  while (* s == '0' && s [1] >= '0' && s [1] <= '9')
+    s ++;
+
+  ip   = s;
+  ilen = strspn (s, "0123456789");
+  s   += ilen;
+  if (* s == '.' || * s == ',')                    /* the decimal separator depends on NLS */
+    {
+      fp   = ++ s;
+      flen = strspn (s, "0123456789");
+      s   += flen;
+    }
+
+  if (* s || (! ilen && ! flen))
+    {
+      value = strtod (text, & end);
+      if (end == text || * end)
+	osh_buf_cat (buf, "null", 4);
+      else
+	json_double (buf, value);
+      return;
+    }
+
+  if (negative)
+    osh_buf_cat (buf, "-", 1);
+  if (ilen)
+    osh_buf_cat (buf, ip, ilen);
+  else
+    osh_buf_cat (buf, "0", 1);
+  if (flen)
+    {
+      osh_buf_cat (buf, ".", 1);
+      osh_buf_cat (buf, fp, flen);
+    }
+}
+
+
+/* Append a date in ISO 8601 format (YYYY-MM-DDTHH:MM:SS) */
+void json_date (osh_buf_t * buf, int year, int month, int day, int hour, int min, int sec)
+{
+  char text [21] = "\"0000-00-00T00:00:00\"";
+  unsigned y = year;
+
+  text [4]  = '0' + y % 10; y /= 10;
+  text [3]  = '0' + y % 10; y /= 10;
+  text [2]  = '0' + y % 10; y /= 10;
+  text [1]  = '0' + y % 10;
+  text [6]  = '0' + month / 10; text [7]  = '0' + month % 10;
+  text [9]  = '0' + day / 10;   text [10] = '0' + day % 10;
+  text [12] = '0' + hour / 10;  text [13] = '0' + hour % 10;
+  text [15] = '0' + min / 10;   text [16] = '0' + min % 10;
+  text [18] = '0' + sec / 10;   text [19] = '0' + sec % 10;
+
+  osh_buf_cat (buf, text, sizeof (text));
+}
@@ -32,6 +32,7 @@ enum
   /* Startup */
   OPT_HELP         = 'h',
   OPT_QUIET        = 'q',
+  OPT_REFRESH      = 'R',
 
   /* Sorting */
   OPT_UNSORT       = 'u',
@@ -49,6 +50,7 @@ static struct option lopts [] =
   /* Startup */
   { "help",    no_argument, NULL, OPT_HELP         },
   { "quiet",   no_argument, NULL, OPT_QUIET        },
+  { "refresh", no_argument, NULL, OPT_REFRESH      },
 
   /* Sorting */
   { "unsort",  no_argument, NULL, OPT_UNSORT       },
@@ -75,6 +77,7 @@ static void usage (char * progname, struct option * options)
   printf ("Startup:\n");
   usage_item (options, n, OPT_HELP,         "show this help message and exit");
   usage_item (options, n, OPT_QUIET,        "run quietly");
+  usage_item (options, n, OPT_REFRESH,      "reload the tables of all connections (in parallel)");
   printf ("\n");
 
   printf ("Sorting options are:\n");
@@ -87,12 +90,78 @@ static void usage (char * progname, struct option * options)
 }
 
 
+/* Format a counter in [buf] */
+static char * counter (char * buf, size_t size, unsigned long long n)
+{
+  snprintf (buf, size, "%llu", n);
+  return buf;
+}
+
+
+/* Format a # of bytes in [buf] in a human readable form (e.g. 1.5K) */
+static char * bytes (char * buf, size_t size, unsigned long long n)
+{
+  static char * units = "KMGTP";
+  double value        = n;
+  int u               = -1;
+
+  while (value >= 1024 && units [u + 1])
+    {
+      value /= 1024;
+      u ++;
+    }
+
+  if (u < 0)
+    snprintf (buf, size, "%llu", n);
+  else
+    snprintf (buf, size, "%.1f%c", value, units [u]);
+
+  return buf;
+}
+
+
+/* Reload the tables of a connection (run by a thread per session) */
+static void * reload (void * conn)
+{
+  ocilib_user_table_count (conn, true);
+  return NULL;
+}
+
+
+/*
+ * Reload the tables of all the connections at once, each on its own
+ * session by its own thread, so that it takes about the time of the
+ * slowest one.  Connections not yet logged on (connect --lazy) or found
+ * dead by the monitor are left alone.
+ */
+static void refresh (osh_connection_t * argv [])
+{
+  unsigned n          = arrlen (argv);
+  pthread_t * threads = calloc (n + 1, sizeof (pthread_t));
+  bool * started      = calloc (n + 1, sizeof (bool));
+  unsigned i;
+
+  for (i = 0; i < n; i ++)
+    if (argv [i] -> handle && ! argv [i] -> dead)
+      if (! (started [i] = ! pthread_create (& threads [i], NULL, reload, argv [i])))
+	reload (argv [i]);                          /* no more threads, do it here */
+
+  for (i = 0; i < n; i ++)
+    if (started [i])
+      pthread_join (threads [i], NULL);
+
+  /* Memory cleanup */
+  free (started);
+  free (threads);
+}
+
+
 /* Print table of connections */
 static void print_connections (osh_connection_t * argv [], bool reverse)
 {
   /* Allocate a matrix to keep header and data */
   unsigned rows = arrlen (argv) + 1;
-  unsigned cols = 8;
+  unsigned cols = 16;
   mx_t * mx     = mxalloc (rows, cols);
   unsigned r    = 0;
   unsigned c    = 0;
@@ -100,39 +169,50 @@ static void print_connections (osh_connection_t * argv [], bool reverse)
 
   /* Table header */
   mxcpy (mx, "#",        r, c ++);
+  mxcpy (mx, "Tag",      r, c ++);
   mxcpy (mx, "TNS Name", r, c ++);
   mxcpy (mx, "User",     r, c ++);
   mxcpy (mx, "Tables",   r, c ++);
   mxcpy (mx, "Records",  r, c ++);
+  mxcpy (mx, "Stmts",    r, c ++);
+  mxcpy (mx, "Trips",    r, c ++);
+  mxcpy (mx, "In",       r, c ++);
+  mxcpy (mx, "Out",      r, c ++);
+  mxcpy (mx, "Latency",  r, c ++);
   mxcpy (mx, "Uptime",   r, c ++);
   mxcpy (mx, "Version",  r, c ++);
+  mxcpy (mx, "Mode",     r, c ++);
+  mxcpy (mx, "Health",   r, c ++);
   mxcpy (mx, "Working",  r, c ++);
 
   /* Insert the records in a matrix */
   for (r = 1; r < rows; r ++)
-    for (c = 0; c < cols; c ++)
-      {
-	unsigned count;
-	conn = reverse ? argv [rows - r - 1] : argv [r - 1];
-
-	/* Force reload */
-	if (conn -> updated)
-	  count = arrlen (conn -> tabv);
-	else
-	  count = ocilib_user_table_count (conn, true);
+    {
+      char buf [32];
+      conn = reverse ? argv [rows - r - 1] : argv [r - 1];
 
+      for (c = 0; c < cols; c ++)
 	switch (c)
 	  {
-	  case 0: mxcpy (mx, utoa (r),                                         r, c); break;
-	  case 1: mxcpy (mx, osh_connection_name (conn),                       r, c); break;
-	  case 2: mxcpy (mx, osh_connection_user (conn),                       r, c); break;
-	  case 3: mxcpy (mx, utoa (count),                                     r, c); break;
-	  case 4: mxcpy (mx, "###",                                            r, c); break;
-	  case 5: mxcpy (mx, relapsed (osh_connection_uptime (conn)),          r, c); break;
-	  case 6: mxcpy (mx, utoa (osh_connection_version (conn)),             r, c); break;
-	  case 7: mxcpy (mx, conn == get_current_connection () ? MARK : "   ", r, c); break;
+	    /* Tables are counted only once cached (no round trip to the Database) */
+	  case 0:  mxcpy (mx, utoa (conn -> id),                                           r, c); break;
+	  case 1:  mxcpy (mx, conn -> tag ? conn -> tag : "",                              r, c); break;
+	  case 2:  mxcpy (mx, osh_connection_name (conn),                                  r, c); break;
+	  case 3:  mxcpy (mx, osh_connection_user (conn),                                  r, c); break;
+	  case 4:  mxcpy (mx, conn -> updated ? utoa (arrlen (conn -> tabv)) : "-",        r, c); break;
+	  case 5:  mxcpy (mx, counter (buf, sizeof (buf), conn -> fetched),                r, c); break;
+	  case 6:  mxcpy (mx, counter (buf, sizeof (buf), conn -> executed),               r, c); break;
+	  case 7:  mxcpy (mx, counter (buf, sizeof (buf), conn -> trips),                  r, c); break;
+	  case 8:  mxcpy (mx, bytes (buf, sizeof (buf), conn -> received),                 r, c); break;
+	  case 9:  mxcpy (mx, bytes (buf, sizeof (buf), conn -> sent),                     r, c); break;
+	  case 10: mxcpy (mx, conn -> trips ? ns2a (conn -> waited / conn -> trips) : "-", r, c); break;
+	  case 11: mxcpy (mx, relapsed (osh_connection_uptime (conn)),                     r, c); break;
+	  case 12: mxcpy (mx, utoa (osh_connection_version (conn)),                        r, c); break;
+	  case 13: mxcpy (mx, osh_connection_mode (conn),                                  r, c); break;
+	  case 14: mxcpy (mx, osh_connection_health (conn),                                r, c); break;
+	  case 15: mxcpy (mx, conn == get_current_connection () ? MARK : "   ",            r, c); break;
 	  }
-      }
+    }
 
   /* Print the data */
   mxprint (mx);
@@ -152,6 +232,7 @@ int osh_lsc (int argc, char * argv [])
   bool quiet      = false;
   osh_connection_t ** conns = NULL;
   bool reverse    = false;
+  bool fresh      = false;
 
   time_t now      = time (NULL);
   struct tm * tm  = localtime (& now);
@@ -177,6 +258,7 @@ int osh_lsc (int argc, char * argv [])
 	  /* Startup */
 	case OPT_HELP:    usage (progname, lopts);              return 0;
 	case OPT_QUIET:   quiet   = true;                       break;
+	case OPT_REFRESH: fresh   = true;                       break;
 
         case OPT_UNSORT:       conns   = get_connections ();    break;
         case OPT_REVERSE:      reverse = true;                  break;
@@ -187,6 +269,10 @@ int osh_lsc (int argc, char * argv [])
 	}
     }
 
+  /* Reload the tables before rendering */
+  if (fresh)
+    refresh (get_connections ());
+
   /* Initialize bootime if not already done */
   if (! osh_run . boottime . tv_sec)
     gettimeofday (& osh_run . boottime, NULL);             /* Set time the program booted */
@@ -17,7 +17,16 @@ osh_connection_t * osh_connection_alloc (OCI_Connection * handle)
 {
   osh_connection_t * conn = calloc (1, sizeof (* conn));
 
+  /* Registry (set when added to the table of connections) */
+  conn -> id        = 0;
+  conn -> tag       = NULL;
+  conn -> prev      = NULL;
+  conn -> next      = NULL;
+
   conn -> handle    = handle;
+  conn -> pool      = NULL;
+  conn -> cclass    = NULL;
+  conn -> logon     = NULL;
   conn -> when      = nswall ();
   conn -> working   = false;
   conn -> error     = NULL;
@@ -26,6 +35,18 @@ osh_connection_t * osh_connection_alloc (OCI_Connection * handle)
   conn -> updated   = 0;
   conn -> tabv      = NULL;
 
+  /* Health */
+  conn -> used      = conn -> when;
+
+  /* Traffic (the calls on the session are accounted to the connection) */
+  conn -> executed  = 0;
+  conn -> fetched   = 0;
+  conn -> trips     = 0;
+  conn -> sent      = 0;
+  conn -> received  = 0;
+  conn -> waited    = 0;
+  ocilib_attach (conn, handle);
+
   return conn;
 }
 
@@ -41,10 +62,17 @@ osh_connection_t * osh_connection_free (osh_connection_t * conn)
 
   argsclear (conn -> tabv);
   safefree (conn -> error);
+  safefree (conn -> cclass);
+  safefree (conn -> tag);
+  osh_logon_free (conn -> logon);
 
   if (conn -> handle)
     ocilib_disconnect (conn -> handle);
 
+  /* Close all the sessions of the pool */
+  if (conn -> pool)
+    OCI_PoolFree (conn -> pool);
+
   free (conn);
   return NULL;
 }
@@ -57,6 +85,111 @@ void osh_connection_done (void * conn)
 }
 
 
+/* === Allocation === */
+osh_logon_t * osh_logon_alloc (char * name, char * user, char * pass, unsigned min, unsigned max, unsigned incr)
+{
+  osh_logon_t * logon = calloc (1, sizeof (* logon));
+
+  logon -> name = safedup (name);
+  logon -> user = safedup (user);
+  logon -> pass = safedup (pass);
+  logon -> min  = min;
+  logon -> max  = max;
+  logon -> incr = incr;
+
+  return logon;
+}
+
+
+/* === Deallocation === */
+osh_logon_t * osh_logon_free (osh_logon_t * logon)
+{
+  if (! logon)
+    return NULL;
+
+  safefree (logon -> name);
+  safefree (logon -> user);
+  safefree (logon -> pass);
+
+  free (logon);
+  return NULL;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* === Allocation === */
+osh_rows_t * osh_rows_alloc (unsigned cols, char * names [], unsigned types [])
+{
+  osh_rows_t * rows = calloc (1, sizeof (* rows));
+  unsigned c;
+
+  rows -> cols  = cols;
+  rows -> names = calloc (cols + 1, sizeof (char *));
+  rows -> types = calloc (cols + 1, sizeof (unsigned));
+  for (c = 0; c < cols; c ++)
+    {
+      rows -> names [c] = safedup (names [c]);
+      rows -> types [c] = types [c];
+    }
+
+  return rows;
+}
+
+
+/* Append a row of [values] and typed [keys] (both are moved) */
+void osh_rows_add (osh_rows_t * rows, char * values [], double keys [])
+{
+  if (rows -> n == rows -> size)
+    {
+      rows -> size = rows -> size ? 2 * rows -> size : 1024;
+      rows -> rows = realloc (rows -> rows, rows -> size * sizeof (osh_row_t));
+      rows -> keys = realloc (rows -> keys, (size_t) rows -> size * rows -> cols * sizeof (double));
+    }
+
+  rows -> rows [rows -> n] . rowno  = rows -> n + 1;
+  rows -> rows [rows -> n] . values = values;
+  rows -> rows [rows -> n] . widths = NULL;
+  memcpy (rows -> keys + (size_t) rows -> n * rows -> cols, keys, rows -> cols * sizeof (double));
+  rows -> n ++;
+
+  free (keys);
+}
+
+
+/* === Deallocation === */
+osh_rows_t * osh_rows_free (osh_rows_t * rows)
+{
+  unsigned r;
+  unsigned c;
+
+  if (! rows)
+    return NULL;
+
+  for (r = 0; r < rows -> n; r ++)
+    {
+      for (c = 0; c < rows -> cols; c ++)
+	safefree (rows -> rows [r] . values [c]);
+      safefree (rows -> rows [r] . values);
+      safefree (rows -> rows [r] . widths);
+    }
+  safefree (rows -> rows);
+  safefree (rows -> keys);
+
+  for (c = 0; c < rows -> cols; c ++)
+    safefree (rows -> names [c]);
+  safefree (rows -> names);
+  safefree (rows -> types);
+  safefree (rows -> database);
+  safefree (rows -> user);
+  safefree (rows -> sql);
+
+  free (rows);
+  return NULL;
+}
+
+
 /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
 
 
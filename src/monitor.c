@@ -0,0 +1,331 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* Project headers */
+#include "osh.h"
+
+
+/*
+ * Health monitor of the connections.
+ *
+ * A background thread pings the connections left idle for a while and
+ * connects again those found dead, waiting longer and longer between
+ * the attempts (exponential backoff).
+ *
+ * The connections are touched only while the shell is not running an
+ * extension, that is while the [shell] lock can be taken.  The monitor
+ * never waits for it (it tries again at the next tick), and both the
+ * pings and the logons run without it, so that a session silently
+ * dropped (eg. by a firewall) never freezes the shell.  The shell breaks
+ * the ping running when it needs the lock, and a call timeout bounds the
+ * ping anyway.
+ */
+
+
+/* First and max # of seconds to wait before attempting to connect again */
+#define MONITOR_BACKOFF      1
+#define MONITOR_BACKOFF_MAX  300
+
+/* Max # of seconds to wait for the reply to a ping */
+#define MONITOR_PING_TIMEOUT 5
+
+
+/* Held by the shell while running an extension */
+static pthread_mutex_t shell = PTHREAD_MUTEX_INITIALIZER;
+
+/* The monitor */
+static pthread_mutex_t lock    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup   = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t finished = PTHREAD_COND_INITIALIZER;
+static OCI_Connection * pinging = NULL;   /* the session being pinged (if any) */
+static bool interrupted        = false;   /* the ping has been broken by the shell */
+static pthread_t monitor;
+static pid_t owner             = 0;       /* the shell, not a child forked by it */
+static bool running            = false;
+static bool quit               = false;
+static unsigned interval       = 0;
+
+
+/* Has the shell asked the monitor to stop? (wait up to [ms] milliseconds for it) */
+static bool stopping (unsigned ms)
+{
+  struct timespec ts;
+  bool stop;
+
+  clock_gettime (CLOCK_REALTIME, & ts);
+  ts . tv_nsec += (long) ms * 1000 * 1000;
+  ts . tv_sec  += ts . tv_nsec / 1000000000;
+  ts . tv_nsec %= 1000000000;
+
+  pthread_mutex_lock (& lock);
+  if (! quit && ms)
+    pthread_cond_timedwait (& wakeup, & lock, & ts);
+  stop = quit;
+  pthread_mutex_unlock (& lock);
+
+  return stop;
+}
+
+
+/* Replace the dead session of [conn] with [handle] (called holding the [shell] lock) */
+static void replace (osh_connection_t * conn, OCI_Connection * handle)
+{
+  /* Statements are released together with their session */
+  conn -> scroll = NULL;
+  ocilib_disconnect (conn -> handle);
+
+  conn -> handle  = handle;
+  ocilib_attach (conn, handle);
+  conn -> dead    = false;
+  conn -> backoff = 0;
+  conn -> reconnects ++;
+}
+
+
+/*
+ * Ping [conn] if it has been idle for a while, unless not yet connected.
+ * The ping runs without the [shell] lock, which is taken again only to
+ * mark the connection dead.  Return false if the monitor has to stop.
+ */
+static bool check (osh_connection_t * conn, rtime_t now)
+{
+  rtime_t every = (rtime_t) interval * 1000000000;
+  OCI_Connection * handle = conn -> handle;
+  unsigned id = conn -> id;
+  bool alive;
+  bool broken;
+
+  if (conn -> dead || conn -> logon || now - conn -> used < every || now - conn -> pinged < every)
+    return true;
+
+  conn -> pinged = now;
+
+  pthread_mutex_lock (& lock);
+  pinging     = handle;
+  interrupted = false;
+  pthread_mutex_unlock (& lock);
+  pthread_mutex_unlock (& shell);
+
+  OCI_SetTimeout (handle, OCI_NTO_CALL, MONITOR_PING_TIMEOUT * 1000);
+  alive = OCI_Ping (handle);
+  OCI_SetTimeout (handle, OCI_NTO_CALL, 0);
+
+  pthread_mutex_lock (& lock);
+  pinging = NULL;
+  broken  = interrupted;
+  pthread_cond_broadcast (& finished);
+  pthread_mutex_unlock (& lock);
+
+  /* Wait for the shell to be idle (unless asked to stop) */
+  while (pthread_mutex_trylock (& shell))
+    if (stopping (100))
+      return false;
+
+  /* A ping broken by the shell says nothing about the session (which may have been closed in the meantime) */
+  if (! alive && ! broken && get_connection (id) == conn && conn -> handle == handle)
+    {
+      conn -> dead    = true;
+      conn -> backoff = MONITOR_BACKOFF;
+    }
+
+  return true;
+}
+
+
+/*
+ * Attempt to connect again [conn] once its backoff has expired.  The
+ * logon runs without the [shell] lock, which is taken again only to
+ * replace the session.  Return false if the monitor has to stop.
+ */
+static bool revive (osh_connection_t * conn, rtime_t now)
+{
+  char * name;
+  char * user;
+  char * pass;
+  OCI_Pool * pool;
+  OCI_Connection * handle;
+  unsigned id = conn -> id;
+
+  if (! conn -> dead || now - conn -> pinged < (rtime_t) conn -> backoff * 1000000000)
+    return true;
+
+  conn -> pinged  = now;
+  conn -> backoff = RMIN (conn -> backoff * 2, MONITOR_BACKOFF_MAX);
+
+  name = safedup (osh_connection_name (conn));
+  user = safedup (osh_connection_user (conn));
+  pass = safedup (osh_connection_pass (conn));
+  pool = conn -> pool;
+  pthread_mutex_unlock (& shell);
+
+  /* A new session (from the pool if any) */
+  if (pool)
+    handle = OCI_PoolGetConnection (pool, NULL);
+  else
+    handle = OCI_ConnectionCreate (name, user, pass, OCI_SESSION_DEFAULT);
+  if (handle && ! OCI_SetAutoCommit (handle, FALSE))
+    handle = ocilib_disconnect (handle);
+
+  safefree (name);
+  safefree (user);
+  safefree (pass);
+
+  /* Wait for the shell to be idle (unless asked to stop) */
+  while (pthread_mutex_trylock (& shell))
+    if (stopping (100))
+      {
+	ocilib_disconnect (handle);
+	return false;
+      }
+
+  /* The connection may have been closed in the meantime */
+  if (handle && get_connection (id) == conn && conn -> dead)
+    replace (conn, handle);
+  else
+    ocilib_disconnect (handle);
+
+  return true;
+}
+
+
+/* The monitor: check the connections once per second */
+static void * watchdog (void * arg)
+{
+  while (! stopping (1000))
+    {
+      unsigned * ids;
+      unsigned n;
+      unsigned i;
+
+      if (pthread_mutex_trylock (& shell))
+	continue;                                  /* the shell is busy, try again later */
+
+      /* The connections may come and go while a logon is running without the lock */
+      n   = len_connections ();
+      ids = calloc (n + 1, sizeof (unsigned));
+      for (i = 0; i < n; i ++)
+	ids [i] = get_connections () [i] -> id;
+
+      for (i = 0; i < n; i ++)
+	{
+	  osh_connection_t * conn = get_connection (ids [i]);
+
+	  if (conn && ! check (conn, nswall ()))
+	    {
+	      free (ids);
+	      return NULL;
+	    }
+
+	  /* The connection may have been closed while the lock was released */
+	  conn = get_connection (ids [i]);
+	  if (conn && ! revive (conn, nswall ()))
+	    {
+	      free (ids);
+	      return NULL;
+	    }
+	}
+      pthread_mutex_unlock (& shell);
+      free (ids);
+    }
+
+  return NULL;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* The shell is about to run an extension: break the ping running, if any, since the extension may use (or close) its session */
+void osh_shell_enter (void)
+{
+  pthread_mutex_lock (& shell);
+
+  pthread_mutex_lock (& lock);
+  if (pinging && ! interrupted)
+    {
+      OCI_Break (pinging);
+      interrupted = true;
+    }
+  while (pinging)
+    pthread_cond_wait (& finished, & lock);
+  pthread_mutex_unlock (& lock);
+}
+
+
+/* The shell has run an extension (the current connection has just been used) */
+void osh_shell_leave (void)
+{
+  osh_connection_t * conn = get_current_connection ();
+
+  if (conn)
+    conn -> used = nswall ();
+  pthread_mutex_unlock (& shell);
+}
+
+
+/*
+ * In a child forked by the shell (eg. an extension in a pipeline) there
+ * is no monitor, and its locks may have been copied while it was holding
+ * them: they must start afresh or the child waits for them forever.
+ */
+static void forked (void)
+{
+  pthread_mutex_init (& shell, NULL);
+  pthread_mutex_init (& lock, NULL);
+  pthread_cond_init (& wakeup, NULL);
+  pthread_cond_init (& finished, NULL);
+  pinging = NULL;
+  running = false;
+}
+
+
+/* Start the monitor to ping the connections idle for [seconds] (0 stops it) */
+bool osh_monitor_start (unsigned seconds)
+{
+  static bool registered = false;
+
+  osh_monitor_stop ();
+  if (! seconds)
+    return true;
+
+  if (! registered)
+    registered = ! pthread_atfork (NULL, NULL, forked);
+
+  interval = seconds;
+  quit     = false;
+  owner    = getpid ();
+  running  = ! pthread_create (& monitor, NULL, watchdog, NULL);
+
+  return running;
+}
+
+
+/* Stop the monitor (also called at the exit of the shell) */
+void osh_monitor_stop (void)
+{
+  if (! running || getpid () != owner)
+    return;
+
+  pthread_mutex_lock (& lock);
+  quit = true;
+  pthread_cond_signal (& wakeup);
+  pthread_mutex_unlock (& lock);
+
+  pthread_join (monitor, NULL);
+  running  = false;
+  interval = 0;
+}
+
+
+/* # of seconds between pings (0 if the monitor is not running) */
+unsigned osh_monitor_interval (void)
+{
+  return running ? interval : 0;
+}
@@ -8,14 +8,24 @@
  */
 
 
-/* Project headers */
+/* System headers */
 #define _GNU_SOURCE
+#include <math.h>
+
+/* Project headers */
 #include "osh.h"
 
 
 /* Constants */
 #define SQL_LEN         10240
 
+/* Rows retrieved per round trip (OCILIB default) */
+#define FETCH_SIZE      20
+
+/* Display width of values (numbers with no declared precision have up to 38 digits, a sign and a decimal point, dates are YYYY-MM-DD HH24:MI:SS) */
+#define NUMERIC_WIDTH   40
+#define DATE_WIDTH      19
+
 /* Reserved keys */
 #define USER_TABLES    "user_tables"
 #define USER_COLUMNS   "user_tab_columns"
@@ -26,26 +36,254 @@
 /* A generic error handler routine */
 static void keeperror (OCI_Error * e)
 {
-  /* A static buffer where to keep Oracle errors */
-  static char error [4096] = "";
+  /* A static buffer where to keep Oracle errors (one per thread) */
+  static __thread char error [4096] = "";
 
   sprintf (error, "%s", OCI_ErrorGetString (e));
 }
 
 
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+/*
+ * Keep track of the client-side fetch array of each Statement in order to
+ * count round trips, and of the rows already received from the server in
+ * order to count them (and their bytes) only once, no matter how many times
+ * they are decoded again.  They are shared by all the threads, since the
+ * shell and the pager's worker fetch from the same ResultSet in turn.
+ */
+#define WINDOWS  256
+
+typedef struct
+{
+  OCI_Statement * st;
+  unsigned lo;              /* first row in the fetch array (0 if none)   */
+  unsigned top;             /* highest row received so far                */
+  unsigned char * seen;     /* rows received (scrollable ResultSets only) */
+  unsigned size;            /* # of bytes in [seen]                        */
+} window_t;
+
+static pthread_mutex_t windows_lock = PTHREAD_MUTEX_INITIALIZER;
+static window_t windows [WINDOWS];
+static unsigned recycled = 0;
+
+
+/* The fetch array of [st], taking the oldest slot for a new one (called holding the lock) */
+static window_t * window_of (OCI_Statement * st)
+{
+  window_t * w;
+  unsigned i;
+
+  for (i = 0; i < WINDOWS; i ++)
+    if (windows [i] . st == st)
+      return & windows [i];
+
+  w = & windows [recycled ++ % WINDOWS];
+  safefree (w -> seen);
+  memset (w, 0, sizeof (* w));
+  w -> st = st;
+
+  return w;
+}
+
+
+/* [st] has been executed (again): nothing received yet */
+static void window_reset (OCI_Statement * st)
+{
+  window_t * w;
+
+  pthread_mutex_lock (& windows_lock);
+  w = window_of (st);
+  safefree (w -> seen);
+  w -> lo   = 0;
+  w -> top  = 0;
+  w -> size = 0;
+  pthread_mutex_unlock (& windows_lock);
+}
+
+
+/* The fetch array of [st] now starts at row [lo] */
+static void window_move (OCI_Statement * st, unsigned lo)
+{
+  pthread_mutex_lock (& windows_lock);
+  window_of (st) -> lo = lo;
+  pthread_mutex_unlock (& windows_lock);
+}
+
+
+/* Is it the first time [row] is received in [w]? (called holding the lock) */
+static bool window_first (window_t * w, unsigned row, bool scrollable)
+{
+  unsigned byte = row / 8;
+  unsigned char bit = 1 << (row % 8);
+
+  if (! scrollable)
+    {
+      /* Forward only: each row is received once, in order */
+      if (row <= w -> top)
+	return false;
+      w -> top = row;
+      return true;
+    }
+
+  /* Scrollable: the rows can be received in any order */
+  if (byte >= w -> size)
+    {
+      unsigned size = RMAX (byte + 1, 2 * w -> size);
+
+      w -> seen = realloc (w -> seen, size);
+      memset (w -> seen + w -> size, 0, size - w -> size);
+      w -> size = size;
+    }
+  if (w -> seen [byte] & bit)
+    return false;
+  w -> seen [byte] |= bit;
+  w -> top = RMAX (w -> top, row);
+
+  return true;
+}
+
+
+/* The connection the calls on session [handle] are accounted to (NULL if none) */
+static osh_connection_t * owner (OCI_Connection * handle)
+{
+  return handle ? OCI_GetUserData (handle) : NULL;
+}
+
+
+/* Add [n] to a traffic counter (the same connection can be used by many threads at once) */
+static void count (unsigned long long * counter, unsigned long long n)
+{
+  __atomic_add_fetch (counter, n, __ATOMIC_RELAXED);
+}
+
+
+/* Account to the connection of [st] [trips] round trips of [elapsed] nsecs, [executed] statements, [rows] fetched, [sent] and [received] bytes */
+static void account_traffic (OCI_Statement * st, unsigned trips, unsigned executed, unsigned rows, size_t sent, size_t received, rtime_t elapsed)
+{
+  osh_connection_t * conn = owner (OCI_StatementGetConnection (st));
+
+  if (! conn)
+    return;
+
+  count (& conn -> trips, trips);
+  count (& conn -> executed, executed);
+  count (& conn -> fetched, rows);
+  count (& conn -> sent, sent);
+  count (& conn -> received, received);
+  if (trips)
+    count (& conn -> waited, elapsed);
+}
+
+
+/* Prepare and Execute a SQL statement keeping track of the time spent */
+static bool timed_execute (OCI_Statement * st, char * query)
+{
+  rtime_t t1 = nswall ();
+
+  if (! OCI_Prepare (st, query))
+    return false;
+  osh_timing_add (OSH_SPAN_PREPARE, nswall () - t1);
+
+  t1 = nswall ();
+  if (! OCI_Execute (st))
+    return false;
+  osh_timing_add (OSH_SPAN_EXECUTE, nswall () - t1);
+  osh_timing_trips (1);
+  account_traffic (st, 1, 1, 0, strlen (query), 0, nswall () - t1);
+  window_reset (st);
+
+  return true;
+}
+
+
+/*
+ * Account for a row just fetched: a round trip is counted each time the
+ * row falls out of the fetch array, the row and its bytes only the first
+ * time it is received from the server.
+ */
+static void account_fetch (OCI_Resultset * rs, rtime_t elapsed)
+{
+  OCI_Statement * st = OCI_ResultsetGetStatement (rs);
+  unsigned row       = OCI_GetCurrentRow (rs);
+  size_t received    = 0;
+  window_t * w;
+  bool trip;
+  bool first;
+
+  pthread_mutex_lock (& windows_lock);
+  w     = window_of (st);
+  trip  = ! w -> lo || row < w -> lo || row >= w -> lo + FETCH_SIZE;
+  if (trip)
+    w -> lo = row;
+  first = window_first (w, row, OCI_GetFetchMode (st) == OCI_SFM_SCROLLABLE);
+  pthread_mutex_unlock (& windows_lock);
+
+  /* The bytes of the row as received, not as decoded */
+  if (first)
+    {
+      unsigned c;
+
+      for (c = 1; c <= OCI_GetColumnCount (rs); c ++)
+	if (! OCI_IsNull (rs, c))
+	  received += OCI_GetDataLength (rs, c);
+    }
+
+  osh_timing_row (elapsed);
+  if (trip)
+    osh_timing_trips (1);
+  account_traffic (st, trip, 0, first, 0, received, elapsed);
+}
+
+
+/* Fetch the next row keeping track of the time spent */
+static bool timed_next (OCI_Resultset * rs)
+{
+  rtime_t t1 = nswall ();
+  bool fetched = OCI_FetchNext (rs);
+
+  if (fetched)
+    account_fetch (rs, nswall () - t1);
+
+  return fetched;
+}
+
+
+/* Move to the absolute [offset] in a scrollable ResultSet keeping track of the time spent */
+static bool timed_seek (OCI_Resultset * rs, unsigned offset)
+{
+  rtime_t t1 = nswall ();
+  bool fetched = OCI_FetchSeek (rs, OCI_SFD_ABSOLUTE, offset);
+
+  if (fetched)
+    account_fetch (rs, nswall () - t1);
+
+  return fetched;
+}
+
+
 /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
 
 
 static char ** get_cached_names (osh_connection_t * conn, bool reload)
 {
+  osh_connection_t * session;
+  char ** names;
+
   if (! conn)
     return NULL;
 
   if (! reload && conn -> tabv)
     return conn -> tabv;
 
+  /* (Re)load them on a session of the pool if any */
+  session = ocilib_borrow (conn);
+  names   = ocilib_table_names (session, USER_TABLES);
+  ocilib_giveback (conn, session);
+
+  argsclear (conn -> tabv);
   conn -> updated = nswall ();
-  conn -> tabv    = ocilib_table_names (conn, USER_TABLES);
+  conn -> tabv    = names;
 
   return conn -> tabv;
 }
@@ -57,7 +295,7 @@ static char ** get_cached_names (osh_connection_t * conn, bool reload)
 char * ocilib_date (OCI_Resultset * rs, unsigned c)
 {
 #define DATEFMT "YYYY-MM-DD HH24:MI:SS"
-  static char buf [128] = { 0x00 };
+  static __thread char buf [128] = { 0x00 };
 
   char * dt = (char *) OCI_GetDate (rs, c);   /* Oracle DATE to keep date and time */
   if (dt && * dt)
@@ -75,6 +313,103 @@ char * ocilib_date (OCI_Resultset * rs, unsigned c)
 }
 
 
+/* Return the label used for the values of unsupported data types */
+static char * type_label (unsigned type)
+{
+  switch (type)
+    {
+    case OCI_UNKNOWN:        return "Unknown";
+    case OCI_CDT_LONG:       return "long (unsupported)";
+    case OCI_CDT_CURSOR:     return "cursor (unsupported)";
+    case OCI_CDT_LOB:        return "lob (unsupported)";
+    case OCI_CDT_FILE:       return "file (unsupported)";
+    case OCI_CDT_TIMESTAMP:  return "timestamp (unsupported)";
+    case OCI_CDT_INTERVAL:   return "interval (unsupported)";
+    case OCI_CDT_RAW:        return "raw (unsupported)";
+    case OCI_CDT_OBJECT:     return "object (unsupported)";
+    case OCI_CDT_COLLECTION: return "collection (unsupported)";
+    case OCI_CDT_REF:        return "ref (unsupported)";
+    case OCI_CDT_BOOLEAN:    return "boolean (unsupported)";
+    default:                 return "default (unsupported)";
+    }
+}
+
+
+/* The typed sort key of the value at column [c] of the current row in [rs] (NAN for text and NULLs) */
+double ocilib_key (OCI_Resultset * rs, unsigned c, unsigned type)
+{
+  int y, m, d, hh, mm, ss;
+
+  if (OCI_IsNull (rs, c))
+    return NAN;
+
+  switch (type)
+    {
+    case OCI_CDT_NUMERIC:
+      return OCI_GetDouble (rs, c);
+
+    case OCI_CDT_DATETIME:
+      if (OCI_DateGetDateTime (OCI_GetDate (rs, c), & y, & m, & d, & hh, & mm, & ss))
+	return ((((y * 100.0 + m) * 100 + d) * 100 + hh) * 100 + mm) * 100 + ss;
+      return NAN;
+
+    default:
+      return NAN;
+    }
+}
+
+
+/*
+ * Return the value at column [c] of the current row in [rs] (NULL for null values).
+ * Numbers are converted by the library with all their digits (no truncation
+ * to integers), so that the same number always gets the same text.
+ */
+char * ocilib_value (OCI_Resultset * rs, unsigned c)
+{
+  unsigned type = OCI_ColumnGetType (OCI_GetColumn (rs, c));
+
+  switch (type)
+    {
+    case OCI_CDT_NUMERIC:  return (char *) OCI_GetString (rs, c);
+    case OCI_CDT_DATETIME: return ocilib_date (rs, c);
+    case OCI_CDT_TEXT:     return (char *) OCI_GetString (rs, c);
+    default:               return type_label (type);
+    }
+}
+
+
+/* Return the max width of a NUMBER([precision], [scale]) with its sign, decimal point and leading zero */
+static unsigned number_width (int precision, int scale)
+{
+  if (precision <= 0)
+    return NUMERIC_WIDTH;
+
+  if (scale < 0)
+    return precision - scale + 1;                  /* eg. NUMBER(5,-2) up to -9999900 */
+
+  return RMAX (precision, scale) + 1 + (scale > 0 ? 2 : 0);
+}
+
+
+/* Return the max width of the values at column [c] in [rs] as announced by the metadata */
+unsigned ocilib_column_width (OCI_Resultset * rs, unsigned c)
+{
+  OCI_Column * col = OCI_GetColumn (rs, c);
+  unsigned type    = OCI_ColumnGetType (col);
+  unsigned width;
+
+  switch (type)
+    {
+    case OCI_CDT_NUMERIC:  width = number_width (OCI_ColumnGetPrecision (col), OCI_ColumnGetScale (col)); break;
+    case OCI_CDT_DATETIME: width = DATE_WIDTH;                 break;
+    case OCI_CDT_TEXT:     width = OCI_ColumnGetSize (col);    break;
+    default:               width = strlen (type_label (type)); break;
+    }
+
+  return RMAX (width, osh_width (OCI_ColumnGetName (col)));
+}
+
+
 /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
 
 
@@ -134,6 +469,7 @@ unsigned rs_size (OCI_Resultset * rs)
 {
   unsigned curr;
   unsigned size;
+  rtime_t t1;
 
   /* Check for a scrollable ResultSet */
   if (! rs || OCI_GetFetchMode (OCI_ResultsetGetStatement (rs)) != OCI_SFM_SCROLLABLE)
@@ -143,17 +479,36 @@ unsigned rs_size (OCI_Resultset * rs)
   curr = OCI_GetCurrentRow (rs);
 
   /* Move to last item of the ResultSet in order to evaluate the size */
+  t1 = nswall ();
   OCI_FetchLast (rs);
 
   size = OCI_GetCurrentRow (rs);
 
   /* Move to old offset */
   OCI_FetchSeek (rs, OCI_SFD_ABSOLUTE, curr);
+  window_move (OCI_ResultsetGetStatement (rs), curr);
+  osh_timing_add (OSH_SPAN_FETCH, nswall () - t1);
+  osh_timing_trips (2);
+  account_traffic (OCI_ResultsetGetStatement (rs), 2, 0, 0, 0, 0, nswall () - t1);
 
   return size;
 }
 
 
+/* Move to the absolute [offset] in a scrollable ResultSet */
+bool ocilib_fetch (OCI_Resultset * rs, unsigned offset)
+{
+  return timed_seek (rs, offset);
+}
+
+
+/* Move to the next row of a ResultSet (either scrollable or not) */
+bool ocilib_next (OCI_Resultset * rs)
+{
+  return timed_next (rs);
+}
+
+
 /* Query the Database and return a ResultSet bound to a new Statement */
 OCI_Resultset * ocilib_resultset (osh_connection_t * conn, char * query)
 {
@@ -172,7 +527,7 @@ OCI_Resultset * ocilib_resultset (osh_connection_t * conn, char * query)
     }
 
   /* Prepare and Execute a SQL statement */
-  if (! OCI_ExecuteStmt (st, query))
+  if (! timed_execute (st, query))
     {
       osh_set_error (conn, "%s:%d ExecuteStmt() - [%s]", __FILE__, __LINE__, OCI_ErrorGetString (OCI_GetLastError ()));
 
@@ -212,7 +567,7 @@ OCI_Resultset * ocilib_scrollable_resultset (osh_connection_t * conn, char * que
     }
 
   /* Prepare and Execute a SQL statement */
-  if (! OCI_ExecuteStmt (st, query))
+  if (! timed_execute (st, query))
     {
       osh_set_error (conn, "%s:%d ExecuteStmt() - [%s]", __FILE__, __LINE__, OCI_ErrorGetString (OCI_GetLastError ()));
 
@@ -252,7 +607,7 @@ unsigned ocilib_table_count (osh_connection_t * conn, char * table)
   sprintf (query, "SELECT COUNT(*) FROM %s", table);
 
   /* Prepare and Execute a SQL statement */
-  if (! OCI_ExecuteStmt (st, query))
+  if (! timed_execute (st, query))
     {
       osh_set_error (conn, "%s:%d ExecuteStmt() - [%s]", __FILE__, __LINE__, OCI_ErrorGetString (OCI_GetLastError ()));
 
@@ -272,7 +627,7 @@ unsigned ocilib_table_count (osh_connection_t * conn, char * table)
     }
 
   /* Retrieve the value from the Database */
-  if (! OCI_FetchNext (rs))
+  if (! timed_next (rs))
     {
       osh_set_error (conn, "%s:%d FetchNext() - [%s]", __FILE__, __LINE__, OCI_ErrorGetString (OCI_GetLastError ()));
 
@@ -315,7 +670,7 @@ char ** ocilib_table_names (osh_connection_t * conn, char * table)
   sprintf (query, "SELECT table_name FROM %s", table);
 
   /* Prepare and Execute a SQL statement */
-  if (! OCI_ExecuteStmt (st, query))
+  if (! timed_execute (st, query))
     {
       osh_set_error (conn, "%s:%d ExecuteStmt() - [%s]", __FILE__, __LINE__, OCI_ErrorGetString (OCI_GetLastError ()));
 
@@ -336,7 +691,7 @@ char ** ocilib_table_names (osh_connection_t * conn, char * table)
 
   /* Loop in the given result set to get values from the Database,
    * allocate a new variable and add it to the vector of table names */
-  while (OCI_FetchNext (rs))
+  while (timed_next (rs))
     argv = argsmore (argv, safedup ((char *) OCI_GetString (rs, 1)));
 
   /* Free the statement and all resources associated to it */
@@ -373,7 +728,7 @@ unsigned ocilib_column_count (osh_connection_t * conn, char * table)
   sprintf (query, "SELECT COUNT(*) FROM %s where table_name = '%s'", USER_COLUMNS, table);
 
   /* Prepare and Execute a SQL statement */
-  if (! OCI_ExecuteStmt (st, query))
+  if (! timed_execute (st, query))
     {
       osh_set_error (conn, "%s:%d ExecuteStmt() - [%s]", __FILE__, __LINE__, OCI_ErrorGetString (OCI_GetLastError ()));
 
@@ -393,7 +748,7 @@ unsigned ocilib_column_count (osh_connection_t * conn, char * table)
     }
 
   /* Retrieve the value from the Database */
-  if (! OCI_FetchNext (rs))
+  if (! timed_next (rs))
     {
       osh_set_error (conn, "%s:%d FetchNext() - [%s]", __FILE__, __LINE__, OCI_ErrorGetString (OCI_GetLastError ()));
 
@@ -436,7 +791,7 @@ char ** ocilib_column_names (osh_connection_t * conn, char * table)
   sprintf (query, "SELECT column_name FROM %s where table_name = '%s'", USER_COLUMNS, table);
 
   /* Prepare and Execute a SQL statement */
-  if (! OCI_ExecuteStmt (st, query))
+  if (! timed_execute (st, query))
     {
       osh_set_error (conn, "%s:%d ExecuteStmt() - [%s]", __FILE__, __LINE__, OCI_ErrorGetString (OCI_GetLastError ()));
 
@@ -457,7 +812,7 @@ char ** ocilib_column_names (osh_connection_t * conn, char * table)
 
   /* Loop in the given result set to get values from the Database,
    * allocate a new variable and add it to the vector of column names */
-  while (OCI_FetchNext (rs))
+  while (timed_next (rs))
     argv = argsmore (argv, safedup ((char *) OCI_GetString (rs, 1)));
 
   /* Free the statement and all resources associated to it */
@@ -491,7 +846,7 @@ osh_column_t ** ocilib_columns (osh_connection_t * conn, char * table)
   sprintf (query, "SELECT column_name, data_type FROM %s where table_name = '%s'", USER_COLUMNS, table);
 
   /* Prepare and Execute a SQL statement */
-  if (! OCI_ExecuteStmt (st, query))
+  if (! timed_execute (st, query))
     {
       osh_set_error (conn, "%s:%d ExecuteStmt() - [%s]", __FILE__, __LINE__, OCI_ErrorGetString (OCI_GetLastError ()));
 
@@ -512,7 +867,7 @@ osh_column_t ** ocilib_columns (osh_connection_t * conn, char * table)
 
   /* Loop in the given result set to get values from the Database,
    * allocate a new variable and add it to the table of results */
-  while (OCI_FetchNext (rs))
+  while (timed_next (rs))
     argv = arrmore (argv, osh_column_alloc ((char *) OCI_GetString (rs, 1), 3, (char *) OCI_GetString (rs, 2)), osh_column_t);
 
   /* Free the statement and all resources associated to it */
@@ -545,7 +900,7 @@ unsigned ocilib_count (osh_connection_t * conn, char * text)
 
   /* Create and execute a SQL statement and retrieve the resultset from the statement */
   st = OCI_StatementCreate (conn -> handle);
-  OCI_ExecuteStmt (st, query);
+  timed_execute (st, query);
   rs = OCI_GetResultset (st);
   if (! rs)
     {
@@ -557,7 +912,7 @@ unsigned ocilib_count (osh_connection_t * conn, char * text)
     }
 
   /* Fetch the next row of the resultset */
-  OCI_FetchNext (rs);
+  timed_next (rs);
   n = OCI_GetInt (rs, 1);
 
   /* Free the statement and all resources associated to it */
@@ -567,19 +922,165 @@ unsigned ocilib_count (osh_connection_t * conn, char * text)
 }
 
 
+/* Execute again the Statement of [rs] (already prepared) and return its new ResultSet */
+OCI_Resultset * ocilib_execute_again (OCI_Resultset * rs)
+{
+  OCI_Statement * st = OCI_ResultsetGetStatement (rs);
+  rtime_t t1 = nswall ();
+
+  if (! OCI_Execute (st))
+    return NULL;
+  osh_timing_add (OSH_SPAN_EXECUTE, nswall () - t1);
+  osh_timing_trips (1);
+  account_traffic (st, 1, 1, 0, 0, 0, nswall () - t1);
+  window_reset (st);
+
+  return OCI_GetResultset (st);
+}
+
+
+/*
+ * Execute again the query [sql] on the connection of [rs] sorted by
+ * [column] (one-based) and return the new scrollable ResultSet.
+ * The caller owns its Statement.
+ */
+OCI_Resultset * ocilib_sorted (OCI_Resultset * rs, char * sql, unsigned column, bool descending)
+{
+  OCI_Statement * st;
+  osh_buf_t query = { NULL, 0, 0 };
+  OCI_Resultset * sorted = NULL;
+
+  st = OCI_StatementCreate (OCI_StatementGetConnection (OCI_ResultsetGetStatement (rs)));
+  if (! st)
+    return NULL;
+
+  /* Build the query */
+  osh_buf_puts (& query, "SELECT * FROM (");
+  osh_buf_puts (& query, sql);
+  osh_buf_puts (& query, ") ORDER BY ");
+  osh_buf_puts (& query, utoa (column));
+  osh_buf_puts (& query, descending ? " DESC NULLS LAST" : " ASC NULLS LAST");
+
+  /* Prepare and Execute a SQL statement */
+  if (OCI_SetFetchMode (st, OCI_SFM_SCROLLABLE) && timed_execute (st, query . data))
+    sorted = OCI_GetResultset (st);
+
+  /* Free the statement and all resources associated to it */
+  if (! sorted)
+    OCI_StatementFree (st);
+
+  /* Memory cleanup */
+  osh_buf_free (& query);
+
+  return sorted;
+}
+
+
+/*
+ * Ask the server for the first row after [from] (or the last one before
+ * it when ! [forward]) of the query bound to [rs] that contains [pattern]
+ * in any of its columns, as they are rendered by ocilib_value().
+ *
+ * The query is wrapped in order to number its rows as the scrollable
+ * ResultSet does, so it returns the matching row number in [found]
+ * (0 if none).  Return false if the wrapped query cannot be executed.
+ */
+bool ocilib_search (OCI_Resultset * rs, char * pattern, unsigned from, bool forward, unsigned * found)
+{
+  OCI_Statement * st = OCI_ResultsetGetStatement (rs);
+  OCI_Statement * search;
+  OCI_Resultset * matches;
+  osh_buf_t query = { NULL, 0, 0 };
+  osh_buf_t text  = { NULL, 0, 0 };
+  unsigned cols   = OCI_GetColumnCount (rs);
+  unsigned c;
+  char * p;
+  bool ok = false;
+
+  * found = 0;
+
+  /* The pattern as a SQL literal */
+  for (p = pattern; * p; p ++)
+    if (* p == '\'')
+      osh_buf_puts (& text, "''");
+    else
+      osh_buf_cat (& text, p, 1);
+
+  /* Number the rows of the original query and filter them on the server */
+  osh_buf_puts (& query, forward ? "SELECT osh_rn_ FROM (SELECT ROWNUM osh_rn_, q.* FROM (" : "SELECT MAX(osh_rn_) FROM (SELECT ROWNUM osh_rn_, q.* FROM (");
+  osh_buf_puts (& query, (char *) OCI_GetSql (st));
+  osh_buf_puts (& query, ") q) WHERE osh_rn_ ");
+  osh_buf_puts (& query, forward ? "> " : "< ");
+  osh_buf_puts (& query, utoa (from));
+  osh_buf_puts (& query, " AND (");
+  for (c = 1; c <= cols; c ++)
+    {
+      OCI_Column * col = OCI_GetColumn (rs, c);
+      unsigned type    = OCI_ColumnGetType (col);
+
+      /* Numbers as the library converts them (same format, no trailing decimal separator) */
+      osh_buf_puts (& query, c > 1 ? " OR INSTR(" : "INSTR(");
+      if (type == OCI_CDT_NUMERIC)
+	osh_buf_puts (& query, "RTRIM(TO_CHAR(");
+      else if (type == OCI_CDT_DATETIME)
+	osh_buf_puts (& query, "TO_CHAR(");
+      osh_buf_puts (& query, "\"");
+      osh_buf_puts (& query, (char *) OCI_ColumnGetName (col));
+      osh_buf_puts (& query, "\"");
+      if (type == OCI_CDT_NUMERIC)
+	{
+	  osh_buf_puts (& query, ", '");
+	  osh_buf_puts (& query, (char *) OCI_GetFormat (OCI_StatementGetConnection (st), OCI_FMT_NUMERIC));
+	  osh_buf_puts (& query, "'), '.,')");
+	}
+      else if (type == OCI_CDT_DATETIME)
+	osh_buf_puts (& query, ", 'YYYY-MM-DD HH24:MI:SS')");
+      osh_buf_puts (& query, ", '");
+      osh_buf_cat (& query, text . data, text . len);
+      osh_buf_puts (& query, "') > 0");
+    }
+  osh_buf_puts (& query, forward ? ") AND ROWNUM = 1" : ")");
+
+  /* Create and execute a SQL statement on the same connection and retrieve the row number */
+  search = OCI_StatementCreate (OCI_StatementGetConnection (st));
+  if (search)
+    {
+      if (timed_execute (search, query . data) && (matches = OCI_GetResultset (search)))
+	{
+	  ok = true;
+	  if (timed_next (matches) && ! OCI_IsNull (matches, 1))
+	    * found = OCI_GetUnsignedInt (matches, 1);
+	}
+
+      /* Free the statement and all resources associated to it */
+      OCI_StatementFree (search);
+    }
+
+  /* Memory cleanup */
+  osh_buf_free (& text);
+  osh_buf_free (& query);
+
+  return ok;
+}
+
+
 /* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
 
 
 /* Initialize the ocilib library */
 bool ocilib_initialize (void)
 {
-  return ! osh_run . initialized ? (osh_run . initialized = OCI_Initialize (NULL, NULL, OCI_ENV_DEFAULT)) : false;
+  return ! osh_run . initialized ? (osh_run . initialized = OCI_Initialize (NULL, NULL, OCI_ENV_THREADED)) : false;
 }
 
 
 /* Clean up all resources allocated by the ocilib library */
 void ocilib_cleanup (void)
 {
+  /* Never pull the environment from under the logons still running */
+  if (connect_pending ())
+    return;
+
   if (osh_run . initialized)
     OCI_Cleanup ();
   osh_run . initialized = false;
@@ -610,6 +1111,168 @@ osh_connection_t * ocilib_connect (char * name, char * user, char * pass)
 }
 
 
+/*
+ * Return the connect string to attach to a pooled server (DRCP) of [name]
+ * with connection class [cclass] and purity [purity] (both optional).
+ *
+ * Connect descriptors get SERVER=POOLED in their CONNECT_DATA and Easy
+ * Connect names the :POOLED suffix, while TNS aliases are taken as they
+ * are since the pooled server has to be configured in tnsnames.ora (so
+ * they cannot be given a connection class or a purity).  Return NULL if
+ * the connect string cannot be rewritten.
+ */
+char * ocilib_drcp_name (char * name, char * cclass, char * purity)
+{
+  char drcp [MAXLINE];
+  char * data;
+
+  if (* name == '(')
+    {
+      /* Connect descriptor */
+      if (! (data = strcasestr (name, "(CONNECT_DATA=")))
+	return NULL;
+      data += strlen ("(CONNECT_DATA=");
+      snprintf (drcp, sizeof (drcp), "%.*s(SERVER=POOLED)%s%s%s%s%s%s%s",
+		(int) (data - name), name,
+		cclass ? "(POOL_CONNECTION_CLASS=" : "", cclass ? cclass : "", cclass ? ")" : "",
+		purity ? "(POOL_PURITY=" : "", purity ? purity : "", purity ? ")" : "",
+		data);
+    }
+  else if (strchr (name, '/') || strchr (name, ':'))
+    {
+      /* Easy Connect */
+      bool pooled = strlen (name) > 7 && ! strcasecmp (name + strlen (name) - 7, ":POOLED");
+
+      snprintf (drcp, sizeof (drcp), "%s%s%s%s%s%s%s",
+		name, pooled ? "" : ":POOLED",
+		cclass || purity ? "?" : "",
+		cclass ? "pool_connection_class=" : "", cclass ? cclass : "",
+		purity ? (cclass ? "&pool_purity=" : "pool_purity=") : "", purity ? purity : "");
+    }
+  else if (cclass || purity)
+    return NULL;
+  else
+    snprintf (drcp, sizeof (drcp), "%s", name);
+
+  return strdup (drcp);
+}
+
+
+/*
+ * Attempt to connect to a Database server via a pool of [min] up to [max]
+ * sessions (growing by [incr]), so that the parallel operations borrow
+ * their sessions from the pool instead of logging on again each time.
+ */
+osh_connection_t * ocilib_connect_pool (char * name, char * user, char * pass, unsigned min, unsigned max, unsigned incr)
+{
+  OCI_Pool * pool;
+  OCI_Connection * handle;
+  osh_connection_t * conn;
+
+  /* Set the global error handler */
+  OCI_SetErrorHandler (keeperror);
+
+  /* Create a session pool and borrow the session for the shell */
+  if (! (pool = OCI_PoolCreate (name, user, pass, OCI_POOL_SESSION, OCI_SESSION_DEFAULT, min, max, incr)))
+    return NULL;
+
+  if (! (handle = OCI_PoolGetConnection (pool, NULL)) || ! OCI_SetAutoCommit (handle, FALSE))
+    {
+      if (handle)
+	OCI_ConnectionFree (handle);
+      OCI_PoolFree (pool);
+      return NULL;
+    }
+
+  conn = osh_connection_alloc (handle);
+  conn -> pool = pool;
+
+  return conn;
+}
+
+
+/* Connect [conn] now that it is used for the first time (connect --lazy) */
+bool ocilib_logon (osh_connection_t * conn)
+{
+  osh_logon_t * logon = conn -> logon;
+  osh_connection_t * real;
+
+  if (! logon)
+    return conn -> handle != NULL;
+
+  if (logon -> max)
+    real = ocilib_connect_pool (logon -> name, logon -> user, logon -> pass, logon -> min, logon -> max, logon -> incr);
+  else
+    real = ocilib_connect (logon -> name, logon -> user, logon -> pass);
+  if (! real)
+    return false;
+
+  /* Take over the session (the connection keeps its place in the table) */
+  conn -> handle = real -> handle;
+  conn -> pool   = real -> pool;
+  conn -> when   = real -> when;
+  conn -> logon  = osh_logon_free (logon);
+
+  real -> handle = NULL;
+  real -> pool   = NULL;
+  osh_connection_free (real);
+  ocilib_attach (conn, conn -> handle);
+
+  return true;
+}
+
+
+/*
+ * Get a session of [conn] for the work of a thread: one from its pool
+ * if any, so that the shell and the other workers are not held up,
+ * otherwise (or when the pool has none to spare) [conn] itself.
+ * No new physical connection is ever made here.
+ */
+osh_connection_t * ocilib_borrow (osh_connection_t * conn)
+{
+  OCI_Connection * handle;
+  osh_connection_t * session;
+
+  if (! conn || ! ocilib_logon (conn))
+    return NULL;
+
+  if (! conn -> pool || ! (handle = OCI_PoolGetConnection (conn -> pool, NULL)))
+    return conn;
+
+  if (! OCI_SetAutoCommit (handle, FALSE))
+    {
+      ocilib_disconnect (handle);
+      return conn;
+    }
+
+  /* The calls on the borrowed session are accounted to [conn] */
+  session = osh_connection_alloc (handle);
+  ocilib_attach (conn, handle);
+
+  return session;
+}
+
+
+/* Account the calls on session [handle] to [conn] */
+void ocilib_attach (osh_connection_t * conn, OCI_Connection * handle)
+{
+  if (handle)
+    OCI_SetUserData (handle, conn);
+}
+
+
+/* Give back to the pool of [conn] a [session] got with ocilib_borrow(), keeping its last error */
+void ocilib_giveback (osh_connection_t * conn, osh_connection_t * session)
+{
+  if (! session || session == conn)
+    return;
+
+  if (session -> error)
+    osh_set_error (conn, "%s", session -> error);
+  osh_connection_free (session);
+}
+
+
 /* Close the physical connection to a Database server */
 OCI_Connection * ocilib_disconnect (OCI_Connection * handle)
 {
@@ -685,39 +1348,24 @@ mx_t * rstomx (unsigned rssize, OCI_Resultset * rs, unsigned size, unsigned offs
 
   /* Loop in the given result set to get values from the Database add it to the table of results */
   r = 1;
-  while (OCI_FetchSeek (rs, OCI_SFD_ABSOLUTE, offset) && r < rows)
+  while (r < rows && timed_seek (rs, offset))
     {
-      mxcpy (mx, utoa (offset ++), r, c = 0);      /* #serial at column 0 */
+      rtime_t t1 = nswall ();
+      char serial [16];
+
+      snprintf (serial, sizeof (serial), "%u", offset ++);
+      mxcpy (mx, serial, r, c = 0);                /* #serial at column 0 */
 
       /* Insert the records in the matrix */
       for (c = 1; c < cols; c ++)
 	{
-	  OCI_Column * col = OCI_GetColumn (rs, c);
-	  char * value = NULL;
-	  switch (OCI_ColumnGetType (col))
-	    {
-	    case OCI_UNKNOWN:        value = "Unknown";                      break;
-	    case OCI_CDT_NUMERIC:    value = utoa (OCI_GetInt (rs, c));      break;
-	    case OCI_CDT_DATETIME:   value = ocilib_date (rs, c);            break;
-	    case OCI_CDT_TEXT:       value = (char *) OCI_GetString (rs, c); break;
-	    case OCI_CDT_LONG:       value = "long (unsupported)";           break;
-	    case OCI_CDT_CURSOR:     value = "cursor (unsupported)";         break;
-	    case OCI_CDT_LOB:        value = "lob (unsupported)";            break;
-	    case OCI_CDT_FILE:       value = "file (unsupported)";           break;
-	    case OCI_CDT_TIMESTAMP:  value = "timestamp (unsupported)";      break;
-	    case OCI_CDT_INTERVAL:   value = "interval (unsupported)";       break;
-	    case OCI_CDT_RAW:        value = "raw (unsupported)";            break;
-	    case OCI_CDT_OBJECT:     value = "object (unsupported)";         break;
-	    case OCI_CDT_COLLECTION: value = "collection (unsupported)";     break;
-	    case OCI_CDT_REF:        value = "ref (unsupported)";            break;
-	    case OCI_CDT_BOOLEAN:    value = "boolean (unsupported)";        break;
-	    default:                 value = "default (unsupported)";        break;
-	    }
+	  char * value = ocilib_value (rs, c);
 
 	  /* Insert the value into the matrix at [r] [c] */
 	  if (value)
 	    mxcpy (mx, value, r, c);
 	}
+      osh_timing_add (OSH_SPAN_FORMAT, nswall () - t1);
       r ++;    /* next row */
     }
 
@@ -734,22 +1382,11 @@ char ** rstoargv (unsigned rssize, OCI_Resultset * rs, unsigned size, unsigned o
   mx_t * mx = rstomx (rssize, rs, size, offset);
   if (mx)
     {
-      unsigned r;
-      unsigned c;
+      rtime_t t1 = nswall ();
 
-      for (r = 0; r < mxrows (mx); r ++)
-	{
-	  char line [MAXLINE];
-	  strcpy (line, "|");
-	  for (c = 0; c < mxcols (mx); c ++)
-	    {
-	      unsigned n = mxcolmaxlen (mx, c);
-	      char buf [MAXLINE];
-	      sprintf (buf, " %-*.*s |", n, n, mxdata (mx) [r * mxcols (mx) + c]);
-	      strcat (line, buf);
-	    }
-	  argv = argsmore (argv, strdup (line));
-	}
+      /* Column widths are evaluated once for the whole page */
+      argv = render_lines (mxdata (mx), NULL, mxrows (mx), mxcols (mx), NULL);
+      osh_timing_add (OSH_SPAN_FORMAT, nswall () - t1);
 
       /* Memory cleanup */
       mxfree (mx);
@@ -777,9 +1414,10 @@ GNode * rstotree (unsigned rssize, OCI_Resultset * rs, unsigned n)
   /* Loop in the given result set to get values from the Database add it to the table of results */
   r = 1;
   cols = OCI_GetColumnCount (rs);
-  while (OCI_FetchSeek (rs, OCI_SFD_ABSOLUTE, r) && (! n || r <= n))
+  while ((! n || r <= n) && timed_seek (rs, r))
     {
       /* The child tree label */
+      rtime_t t1 = nswall ();
       GNode * child;
       char label [1024];
       sprintf (label, "#%u", r ++);
@@ -788,35 +1426,15 @@ GNode * rstotree (unsigned rssize, OCI_Resultset * rs, unsigned n)
       /* Insert the records in the tree */
       for (c = 1; c <= cols; c ++)
 	{
-	  OCI_Column * col = OCI_GetColumn (rs, c);
-	  char * value = NULL;
+	  char * value = ocilib_value (rs, c);
 	  char buf [1024];
 
-	  switch (OCI_ColumnGetType (col))
-	    {
-	    case OCI_UNKNOWN:        value = "Unknown";                      break;
-	    case OCI_CDT_NUMERIC:    value = utoa (OCI_GetInt (rs, c));      break;
-	    case OCI_CDT_DATETIME:   value = ocilib_date (rs, c);            break;
-	    case OCI_CDT_TEXT:       value = (char *) OCI_GetString (rs, c); break;
-	    case OCI_CDT_LONG:       value = "long (unsupported)";           break;
-	    case OCI_CDT_CURSOR:     value = "cursor (unsupported)";         break;
-	    case OCI_CDT_LOB:        value = "lob (unsupported)";            break;
-	    case OCI_CDT_FILE:       value = "file (unsupported)";           break;
-	    case OCI_CDT_TIMESTAMP:  value = "timestamp (unsupported)";      break;
-	    case OCI_CDT_INTERVAL:   value = "interval (unsupported)";       break;
-	    case OCI_CDT_RAW:        value = "raw (unsupported)";            break;
-	    case OCI_CDT_OBJECT:     value = "object (unsupported)";         break;
-	    case OCI_CDT_COLLECTION: value = "collection (unsupported)";     break;
-	    case OCI_CDT_REF:        value = "ref (unsupported)";            break;
-	    case OCI_CDT_BOOLEAN:    value = "boolean (unsupported)";        break;
-	    default:                 value = "default (unsupported)";        break;
-	    }
-
 	  /* Append the value into the tree */
-	  sprintf (buf, "%s - %s", OCI_ColumnGetName (OCI_GetColumn (rs, c)), value);
+	  snprintf (buf, sizeof (buf), "%s - %s", OCI_ColumnGetName (OCI_GetColumn (rs, c)), value ? value : "");
 	  g_node_append_data (child, strdup (buf));
 	}
       g_node_append (root, child);
+      osh_timing_add (OSH_SPAN_FORMAT, nswall () - t1);
     }
 
   return root;
@@ -14,14 +14,17 @@
 /* System headers */
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdarg.h>
 #include <time.h>
 #include <sys/time.h>
 #include <libgen.h>
 #include <getopt.h>
 #include <signal.h>
+#include <pthread.h>
 
 
 /* Project headers */
@@ -49,10 +52,27 @@
 /* Small buffer size */
 #define MAXLINE 4096
 
+/* The offset basis of FNV-1a hashes (see osh_hash) */
+#define OSH_HASH_INIT  2166136261u
+
 
 /* Typedefs */
 
 
+/* Client-side spans measured for each DB builtin */
+typedef enum
+{
+  OSH_SPAN_PREPARE,         /* parse the SQL statement                    */
+  OSH_SPAN_EXECUTE,         /* execute the SQL statement on the server    */
+  OSH_SPAN_FIRSTROW,        /* wait for the first row                     */
+  OSH_SPAN_FETCH,           /* fetch all the remaining rows               */
+  OSH_SPAN_FORMAT,          /* convert values and build the output        */
+  OSH_SPAN_OUTPUT,          /* render the output                          */
+  OSH_SPANS
+
+} osh_span_t;
+
+
 /* The structure contains information on the commands the application can understand */
 typedef struct
 {
@@ -65,10 +85,137 @@ typedef struct
 } osh_command_t;
 
 
-/* A Connection */
+/* A comparison function for sorting (with a user argument) */
+typedef int (* osh_cmp_t) (const void * a, const void * b, void * arg);
+
+
+/* A growable buffer */
 typedef struct
 {
+  char * data;              /* null terminated content                    */
+  size_t len;               /* # of bytes in use                          */
+  size_t size;              /* # of bytes allocated                       */
+
+} osh_buf_t;
+
+
+/* A row kept in the cache of the viewer */
+typedef struct
+{
+  unsigned rowno;           /* one-based row number (0 if empty)          */
+  char ** values;           /* decoded values of all the columns          */
+  size_t * widths;          /* display widths of the values (or NULL)     */
+
+} osh_row_t;
+
+
+/* Rows decoded in memory (eg. merged from many connections) */
+typedef struct
+{
+  unsigned cols;            /* # of columns                               */
+  char ** names;            /* column names                               */
+  unsigned * types;         /* OCI_CDT_xxx of each column                 */
+  unsigned n;               /* # of rows                                  */
+  unsigned size;            /* # of rows allocated                        */
+  osh_row_t * rows;         /* decoded values (NULL for NULLs)            */
+  double * keys;            /* typed keys of numbers and dates            */
+
+  /* Where the rows come from */
+  char * database;
+  char * user;
+  char * sql;
+
+} osh_rows_t;
+
+
+/* How rows coming one at a time are rendered */
+typedef enum
+{
+  OSH_RENDER_TABLE,
+  OSH_RENDER_VERTICAL,
+  OSH_RENDER_JSON,
+  OSH_RENDER_JSONL
+
+} osh_render_t;
+
+
+/* Rows rendered as they come (eg. merged from many connections) */
+typedef struct
+{
+  osh_render_t format;
+  osh_rows_t * head;        /* columns and first rows to size the table   */
+  unsigned sample;          /* # of rows to size the table on (0 = all)   */
+  unsigned n;               /* # of rows rendered                         */
+  unsigned * widths;        /* of the table columns (NULL until sized)    */
+  osh_buf_t * labels;       /* column names as line prefixes or JSON keys */
+  osh_buf_t sep;            /* table separator line                       */
+  osh_buf_t line;
+
+} osh_stream_t;
+
+
+/* The cache of the rows around the page displayed by the viewer */
+typedef struct
+{
+  OCI_Resultset * rs;       /* scrollable Result Set (NULL if in memory)  */
+  unsigned total;           /* # of rows in the Result Set                */
+  unsigned rssize;          /* # of rows displayed (after filtering)      */
+  unsigned cols;            /* # of columns                               */
+  unsigned pagesize;        /* # of rows per page                         */
+  char ** names;            /* column names                               */
+  char * database;          /* where the rows come from                   */
+  char * user;
+  char * sql;
+
+  unsigned capacity;        /* # of slots in the ring                     */
+  osh_row_t * ring;         /* row [n] is kept at slot (n - 1) % capacity */
+
+  pthread_t worker;         /* background prefetch                        */
+  pthread_mutex_t fetch;    /* serialize the access to the Result Set     */
+  pthread_mutex_t lock;     /* guard the ring and the requests            */
+  pthread_cond_t wakeup;    /* signal a new request to the worker         */
+  unsigned want;            /* first row of the page displayed            */
+  bool pending;             /* the worker has a new request               */
+  bool quit;                /* the worker must terminate                  */
+  unsigned generation;      /* incremented each time rows are reordered   */
+
+  /* All the rows in memory (small Result Sets only, to sort and filter) */
+  osh_row_t * all;          /* decoded rows                               */
+  double * keys;            /* typed keys of numbers and dates            */
+  unsigned * perm;          /* sort order of all the rows                 */
+  unsigned * order;         /* rows displayed, in sort order              */
+  char * filter;            /* only rows containing this are displayed    */
+
+} osh_pager_t;
+
+
+/* The logon of a connection deferred until its first use (connect --lazy) */
+typedef struct
+{
+  char * name;              /* TNS name (or connect string)               */
+  char * user;              /* NULL for external credentials (wallet)     */
+  char * pass;
+  unsigned min;             /* session pool (max 0 for a dedicated one)   */
+  unsigned max;
+  unsigned incr;
+
+} osh_logon_t;
+
+
+/* A Connection */
+typedef struct osh_connection
+{
+  /* Registry */
+  unsigned id;              /* stable identifier (never reused)           */
+  char * tag;               /* user-defined name (NULL if none)           */
+  struct osh_connection * prev;   /* previous in order of connection      */
+  struct osh_connection * next;   /* next in order of connection          */
+
   OCI_Connection * handle;  /* pointer to underlaying connection handler  */
+  OCI_Pool * pool;          /* session pool (NULL for a dedicated one)    */
+  char * cclass;            /* DRCP connection class (NULL if no DRCP)    */
+                            /* ("(alias)" if asked for a TNS alias)       */
+  osh_logon_t * logon;      /* deferred logon (NULL once connected)       */
   rtime_t when;             /* connection time at nsec resolution         */
   bool working;             /* flag to indicate if it is currently in use */
 
@@ -80,6 +227,21 @@ typedef struct
   rtime_t updated;          /* last updated at nsec resolution            */
   char ** tabv;             /* user table names                           */
 
+  /* Health */
+  rtime_t used;             /* last used by a command at nsec resolution  */
+  rtime_t pinged;           /* last ping or logon attempt by the monitor  */
+  bool dead;                /* the last ping has failed                   */
+  unsigned backoff;         /* seconds to wait before the next logon      */
+  unsigned reconnects;      /* # of times connected again by the monitor  */
+
+  /* Traffic (counted by the calls to the Database, even from threads) */
+  unsigned long long executed;    /* # of statements executed             */
+  unsigned long long fetched;     /* # of rows fetched                    */
+  unsigned long long trips;       /* # of round trips                     */
+  unsigned long long sent;        /* bytes of SQL text sent               */
+  unsigned long long received;    /* bytes of values decoded              */
+  unsigned long long waited;      /* nsecs spent in round trips           */
+
 } osh_connection_t;
 
 
@@ -149,9 +311,11 @@ extern osh_command_t cmd_dtree;
 
 /* === Viewers === */
 extern osh_command_t cmd_select;
+extern osh_command_t cmd_xselect;
 
 /* === Applications === */
 extern osh_command_t cmd_ping;
+extern osh_command_t cmd_each;
 
 
 /* Public functions in file tcsh-wrap.c */
@@ -162,6 +326,8 @@ void unset_variable (char * var);
 void set_completions (void);
 void tcsh_builtins (int argc, char * argv []);
 
+bool is_variable (char * name);
+
 /* Public functions in file init.c */
 void osh_init (char * progname, int quiet);
 
@@ -172,11 +338,33 @@ void osh_prompt (char * text);
 osh_connection_t * osh_connection_alloc (OCI_Connection * handle);
 osh_connection_t * osh_connection_free (osh_connection_t * conn);
 void osh_connection_done (void * conn);
+osh_logon_t * osh_logon_alloc (char * name, char * user, char * pass, unsigned min, unsigned max, unsigned incr);
+osh_logon_t * osh_logon_free (osh_logon_t * logon);
+
+osh_rows_t * osh_rows_alloc (unsigned cols, char * names [], unsigned types []);
+void osh_rows_add (osh_rows_t * rows, char * values [], double keys []);
+osh_rows_t * osh_rows_free (osh_rows_t * rows);
 
 osh_column_t * osh_column_alloc (char * name, unsigned type, char * value);
 osh_column_t * osh_column_free (osh_column_t * col);
 void osh_column_done (void * col);
 
+/* Public functions in file output.c */
+void osh_output_init (void);
+void osh_output_begin (void);
+void osh_output_end (void);
+void osh_output_flush (void);
+bool osh_output_broken (void);
+void osh_progress (char * fmt, ...);
+
+/* Public functions in file timing.c */
+void osh_timing_reset (void);
+bool osh_timing_enabled (bool option);
+void osh_timing_add (osh_span_t span, rtime_t elapsed);
+void osh_timing_trips (unsigned n);
+void osh_timing_row (rtime_t elapsed);
+void osh_timing_print (char * progname);
+
 /* === Containers === */
 
 /* Public functions in file commands.c */
@@ -187,11 +375,36 @@ osh_command_t * cmd_lookup (unsigned i);
 char * cmd_by_index (unsigned i);
 unsigned maxname (void);
 
+/* Public functions in file buffer.c */
+void osh_buf_reset (osh_buf_t * buf);
+void osh_buf_free (osh_buf_t * buf);
+void osh_buf_cat (osh_buf_t * buf, const char * s, size_t n);
+void osh_buf_puts (osh_buf_t * buf, const char * s);
+void osh_buf_pad (osh_buf_t * buf, char c, size_t n);
+size_t osh_buf_write (osh_buf_t * buf, FILE * fd);
+
+/* Public functions in file hash.c */
+unsigned osh_hash (const void * data, size_t len, unsigned h);
+unsigned osh_strhash (const char * s);
+
+/* Public functions in file decimal.c */
+bool osh_decimal_cmp (const char * a, const char * b, int * cmp);
+char * osh_decimal_add (const char * a, const char * b);
+
+/* Public functions in file sort.c */
+void osh_sort (void * base, size_t n, size_t size, osh_cmp_t cmp, void * arg);
+
+/* Public functions in file width.c */
+size_t osh_strclip (const char * s, size_t len, size_t max, size_t * width);
+size_t osh_strwidth (const char * s, size_t len);
+size_t osh_width (const char * s);
+
 /* Public functions in file connections.c */
 char * osh_connection_name (osh_connection_t * conn);
 char * osh_connection_user (osh_connection_t * conn);
 char * osh_connection_pass (osh_connection_t * conn);
 OCI_Connection * osh_connection_handle (osh_connection_t * conn);
+char * osh_connection_mode (osh_connection_t * conn);
 rtime_t osh_connection_uptime (osh_connection_t * conn);
 unsigned osh_connection_version (osh_connection_t * conn);
 char * osh_connection_banner (osh_connection_t * conn);
@@ -202,14 +415,18 @@ bool osh_connection_get_working (osh_connection_t * conn);
 void osh_connection_set_working (osh_connection_t * conn, bool status);
 
 osh_connection_t * get_current_connection (void);
+osh_connection_t * get_active_connection (void);
 void set_current_connection (osh_connection_t * conn);
 void reset_current_connection (osh_connection_t * conn);
 osh_connection_t * get_connection (unsigned id);
+osh_connection_t * find_connection (char * what);
+bool osh_connection_matches (osh_connection_t * conn, char * pattern);
 unsigned len_connections (void);
 void add_connection (osh_connection_t * conn);
 void del_connection (osh_connection_t * conn);
 
 osh_connection_t ** get_connections (void);
+char * osh_connection_health (osh_connection_t * conn);
 osh_connection_t ** conn_sort_by_tnsname (void);
 osh_connection_t ** conn_sort_by_user (void);
 osh_connection_t ** conn_sort_by_uptime (void);
@@ -217,6 +434,13 @@ osh_connection_t ** conn_rev_sort_by_tnsname (void);
 osh_connection_t ** conn_rev_sort_by_user (void);
 osh_connection_t ** conn_rev_sort_by_uptime (void);
 
+/* Public functions in file monitor.c */
+void osh_shell_enter (void);
+void osh_shell_leave (void);
+bool osh_monitor_start (unsigned seconds);
+void osh_monitor_stop (void);
+unsigned osh_monitor_interval (void);
+
 /* === Helpers === */
 
 /* Public functions in file help.c */
@@ -241,6 +465,9 @@ int osh_when (int argc, char * argv []);
 /* Public functions in file ocilib.c */
 
 char * ocilib_date (OCI_Resultset * rs, unsigned c);
+char * ocilib_value (OCI_Resultset * rs, unsigned c);
+double ocilib_key (OCI_Resultset * rs, unsigned c, unsigned type);
+unsigned ocilib_column_width (OCI_Resultset * rs, unsigned c);
 GNode * osh_mktree (osh_connection_t * conn, bool reload, bool expand);
 
 unsigned ocilib_table_count (osh_connection_t * conn, char * table);
@@ -251,6 +478,12 @@ char ** ocilib_column_names (osh_connection_t * conn, char * table);
 bool ocilib_initialize (void);
 void ocilib_cleanup (void);
 osh_connection_t * ocilib_connect (char * name, char * user, char * pass);
+char * ocilib_drcp_name (char * name, char * cclass, char * purity);
+osh_connection_t * ocilib_connect_pool (char * name, char * user, char * pass, unsigned min, unsigned max, unsigned incr);
+bool ocilib_logon (osh_connection_t * conn);
+osh_connection_t * ocilib_borrow (osh_connection_t * conn);
+void ocilib_attach (osh_connection_t * conn, OCI_Connection * handle);
+void ocilib_giveback (osh_connection_t * conn, osh_connection_t * session);
 OCI_Connection * ocilib_disconnect (OCI_Connection * handle);
 bool ocilib_status (OCI_Connection * handle);
 
@@ -259,6 +492,11 @@ char ** ocilib_column_names (osh_connection_t * conn, char * table);
 osh_column_t ** ocilib_columns (osh_connection_t * conn, char * table);
 
 unsigned rs_size (OCI_Resultset * rs);
+bool ocilib_fetch (OCI_Resultset * rs, unsigned offset);
+bool ocilib_next (OCI_Resultset * rs);
+bool ocilib_search (OCI_Resultset * rs, char * pattern, unsigned from, bool forward, unsigned * found);
+OCI_Resultset * ocilib_execute_again (OCI_Resultset * rs);
+OCI_Resultset * ocilib_sorted (OCI_Resultset * rs, char * sql, unsigned column, bool descending);
 OCI_Resultset * ocilib_resultset (osh_connection_t * conn, char * query);
 OCI_Resultset * ocilib_scrollable_resultset (osh_connection_t * conn, char * query);
 
@@ -272,11 +510,49 @@ GNode * rstotree (unsigned rssize, OCI_Resultset * rs, unsigned n);
 void print_record (OCI_Resultset * rs);
 
 void print_curses (unsigned rssize, OCI_Resultset * rs, unsigned wsize, char * progname, char * version);
+void print_curses_rows (osh_rows_t * rows, unsigned wsize, char * progname, char * version);
+void watch_curses (OCI_Resultset * rs, unsigned wsize, unsigned seconds, char * progname, char * version);
+
+/* Public functions in file json.c */
+void json_string (osh_buf_t * buf, const char * s, size_t len);
+void json_integer (osh_buf_t * buf, long long value);
+void json_double (osh_buf_t * buf, double value);
+void json_number (osh_buf_t * buf, const char * text);
+void json_date (osh_buf_t * buf, int year, int month, int day, int hour, int min, int sec);
+
+/* Public functions in file render.c */
+void render_table (unsigned rssize, OCI_Resultset * rs, unsigned n, unsigned sample);
+void render_vertical (unsigned rssize, OCI_Resultset * rs, unsigned n);
+void render_json (unsigned rssize, OCI_Resultset * rs, unsigned n, bool lines);
+osh_stream_t * render_stream_begin (osh_render_t format, unsigned cols, char * names [], unsigned types [], unsigned sample);
+bool render_stream_row (osh_stream_t * stream, char * values [], double keys []);
+unsigned render_stream_end (osh_stream_t * stream);
+void render_rows (osh_rows_t * mem, unsigned n, osh_render_t format);
+char ** render_lines (char * cells [], size_t widths [], unsigned rows, unsigned cols, size_t * offsets);
+
+/* Public functions in file watch.c */
+char ** watch_snapshot (OCI_Resultset * rs, unsigned n, unsigned * rows);
+void watch_free (char ** cells, unsigned rows, unsigned cols);
+unsigned watch_diff (char ** before, unsigned brows, char ** now, unsigned nrows, unsigned cols, bool * marks);
+char ** watch_lines (OCI_Resultset * rs, char ** cells, unsigned rows, size_t ** offsets);
+void watch_table (OCI_Resultset * rs, unsigned n, unsigned seconds);
+
+/* Public functions in file pager.c */
+osh_pager_t * pager_alloc (unsigned rssize, OCI_Resultset * rs, unsigned pagesize);
+osh_pager_t * pager_alloc_rows (osh_rows_t * rows, unsigned pagesize);
+void pager_free (osh_pager_t * pager);
+void pager_resize (osh_pager_t * pager, unsigned pagesize);
+void pager_prefetch (osh_pager_t * pager, unsigned offset);
+char ** pager_lines (osh_pager_t * pager, unsigned offset, unsigned n, size_t ** offsets);
+unsigned pager_search (osh_pager_t * pager, char * pattern, unsigned from, bool forward);
+bool pager_sort (osh_pager_t * pager, unsigned column, bool descending);
+bool pager_filter (osh_pager_t * pager, char * pattern);
 
 
 /* === Connections === */
 
 /* Public functions in file connect.c */
+unsigned connect_pending (void);
 int osh_connect (int argc, char * argv []);
 
 /* Public functions in file disconnect.c */
@@ -299,9 +575,15 @@ int osh_describe (int argc, char * argv []);
 /* Public functions in file select.c */
 int osh_select (int argc, char * argv []);
 
+/* Public functions in file xselect.c */
+int osh_xselect (int argc, char * argv []);
+
 /* Public functions in file ping.c */
 int osh_oping (int argc, char * argv []);
 
+/* Public functions in file each.c */
+int osh_each (int argc, char * argv []);
+
 
 /*
  * -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
@@ -0,0 +1,85 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* Project headers */
+#include "osh.h"
+
+
+/*
+ * Output of the builtins.
+ *
+ * stdout is given a large buffer once at startup, before its first use,
+ * so that the writes of a builtin are collected and flushed at the end of
+ * the command or when the buffer is full.  Progress messages bypass the
+ * buffer and are written straight to the terminal in order to be shown
+ * before the builtin blocks (eg. waiting for the server).
+ */
+
+
+/* Size of the output buffer (stdout is flushed each time it fills) */
+#define OUTBUF_SIZE  (64 * 1024)
+
+
+static char outbuf [OUTBUF_SIZE];
+
+
+/* Buffer stdout (to be called once before anything is written to it) */
+void osh_output_init (void)
+{
+  setvbuf (stdout, outbuf, _IOFBF, sizeof (outbuf));
+}
+
+
+/* Start collecting the output of a builtin (forget that a previous reader has gone) */
+void osh_output_begin (void)
+{
+  clearerr (stdout);
+}
+
+
+/* Write out the output of a builtin once it has returned */
+void osh_output_end (void)
+{
+  fflush (stdout);
+  clearerr (stdout);
+}
+
+
+/* Write out everything buffered so far (eg. before to wait for user input) */
+void osh_output_flush (void)
+{
+  fflush (stdout);
+}
+
+
+/* Is the reader gone? (eg. [select ... | head] once head has exited) */
+bool osh_output_broken (void)
+{
+  return ferror (stdout);
+}
+
+
+/* Print a progress message immediately by write(2), after all the output buffered so far */
+void osh_progress (char * fmt, ...)
+{
+  char line [MAXLINE];
+  va_list va_ap;
+  int len;
+
+  fflush (stdout);
+
+  va_start (va_ap, fmt);
+  len = vsnprintf (line, sizeof (line), fmt, va_ap);
+  va_end (va_ap);
+
+  /* Messages too long are truncated */
+  if (len > 0)
+    len = write (STDOUT_FILENO, line, RMIN ((size_t) len, sizeof (line) - 1));
+}
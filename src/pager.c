@@ -0,0 +1,781 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* System headers */
+#define _GNU_SOURCE
+#include <math.h>
+
+/* Project headers */
+#include "osh.h"
+
+
+/*
+ * The cache of the curses viewer.
+ *
+ * Decoded rows are kept in a ring of slots around the page currently
+ * displayed (row [n] always goes in slot (n - 1) % capacity), and a
+ * worker thread fetches the next and the previous pages while the user
+ * reads the current one, so that paging is served from memory.
+ *
+ * Two locks, [lock] is taken while holding [fetch] only when the rows
+ * are reordered (never the other way round):
+ *  - [fetch] serializes the access to the ResultSet (and the round trips)
+ *  - [lock] guards the ring and the requests to the worker
+ *
+ * Small ResultSets can also be read all in memory, in order to sort
+ * and filter them without asking the server, and rows already decoded
+ * in memory (eg. merged from many connections) are displayed as well.
+ */
+
+
+/* # of pages kept in the ring */
+#define PAGER_PAGES   8
+
+/* Max # of rows to keep in memory for sorting and filtering */
+#define PAGER_MEMORY  200000
+
+/* # of pages to prefetch after and before the current one */
+#define PAGER_AHEAD   3
+#define PAGER_BEHIND  1
+
+
+/* Release the values kept in [slot] */
+static void slot_clear (osh_row_t * slot, unsigned cols)
+{
+  unsigned c;
+
+  if (slot -> values)
+    for (c = 0; c < cols; c ++)
+      safefree (slot -> values [c]);
+  safefree (slot -> values);
+  safefree (slot -> widths);
+  slot -> values = NULL;
+  slot -> widths = NULL;
+  slot -> rowno  = 0;
+}
+
+
+/* Is row [rowno] already in the ring? */
+static bool cached (osh_pager_t * pager, unsigned rowno)
+{
+  bool hit;
+
+  pthread_mutex_lock (& pager -> lock);
+  hit = pager -> ring [(rowno - 1) % pager -> capacity] . rowno == rowno;
+  pthread_mutex_unlock (& pager -> lock);
+
+  return hit;
+}
+
+
+/* Does any of the [cols] values contain [pattern]? */
+static bool matches (char * values [], unsigned cols, char * pattern, size_t len)
+{
+  unsigned c;
+
+  for (c = 0; c < cols; c ++)
+    if (values [c] && memmem (values [c], strlen (values [c]), pattern, len))
+      return true;
+  return false;
+}
+
+
+/* Duplicate the [cols] values of a row */
+static char ** values_dup (char * values [], unsigned cols)
+{
+  char ** dup = calloc (cols, sizeof (char *));
+  unsigned c;
+
+  for (c = 0; c < cols; c ++)
+    dup [c] = values [c] ? strdup (values [c]) : NULL;
+
+  return dup;
+}
+
+
+/* Evaluate once the display widths of the [cols] values of a row */
+static size_t * values_widths (char * values [], unsigned cols)
+{
+  size_t * widths = calloc (cols, sizeof (size_t));
+  unsigned c;
+
+  for (c = 0; c < cols; c ++)
+    widths [c] = values [c] ? osh_width (values [c]) : 0;
+
+  return widths;
+}
+
+
+/* Fetch and decode row [rowno] unless already in the ring */
+static void load (osh_pager_t * pager, unsigned rowno)
+{
+  char ** values  = NULL;
+  size_t * widths = NULL;
+  osh_row_t * slot;
+  unsigned generation;
+  unsigned c;
+
+  if (! rowno || cached (pager, rowno))
+    return;
+
+  pthread_mutex_lock (& pager -> fetch);
+  generation = pager -> generation;
+  if (rowno > pager -> rssize)
+    ;
+  else if (pager -> all)
+    {
+      /* All the rows are in memory (sorted and filtered by [order]) */
+      osh_row_t * row = & pager -> all [pager -> order [rowno - 1]];
+      if (! row -> widths)
+	row -> widths = values_widths (row -> values, pager -> cols);
+      values = values_dup (row -> values, pager -> cols);
+      widths = memcpy (calloc (pager -> cols, sizeof (size_t)), row -> widths, pager -> cols * sizeof (size_t));
+    }
+  else
+    {
+      /* Decode all the values while the ResultSet is positioned on the row */
+      values = calloc (pager -> cols, sizeof (char *));
+      if (ocilib_fetch (pager -> rs, rowno))
+	for (c = 0; c < pager -> cols; c ++)
+	  {
+	    char * value = ocilib_value (pager -> rs, c + 1);
+	    values [c] = value ? strdup (value) : NULL;
+	  }
+    }
+  pthread_mutex_unlock (& pager -> fetch);
+
+  if (! values)
+    return;
+
+  /* Once per row, not each time it is displayed */
+  if (! widths)
+    widths = values_widths (values, pager -> cols);
+
+  /* Replace the row previously kept in the slot (unless the rows have been reordered in the meantime) */
+  pthread_mutex_lock (& pager -> lock);
+  if (generation == pager -> generation)
+    {
+      slot = & pager -> ring [(rowno - 1) % pager -> capacity];
+      slot_clear (slot, pager -> cols);
+      slot -> rowno  = rowno;
+      slot -> values = values;
+      slot -> widths = widths;
+      values = NULL;
+    }
+  pthread_mutex_unlock (& pager -> lock);
+
+  if (values)
+    {
+      osh_row_t stale = { rowno, values, widths };
+      slot_clear (& stale, pager -> cols);
+    }
+}
+
+
+/* Has the user moved to another page since the worker started? */
+static bool moved (osh_pager_t * pager)
+{
+  bool pending;
+
+  pthread_mutex_lock (& pager -> lock);
+  pending = pager -> pending || pager -> quit;
+  pthread_mutex_unlock (& pager -> lock);
+
+  return pending;
+}
+
+
+/* The worker: fill the ring with the pages around the one currently displayed */
+static void * prefetch (void * arg)
+{
+  osh_pager_t * pager = arg;
+
+  pthread_mutex_lock (& pager -> lock);
+  while (! pager -> quit)
+    {
+      unsigned want;
+      unsigned pagesize;
+      unsigned rssize;
+      unsigned first;
+      unsigned last;
+      unsigned r;
+
+      /* Wait for a request */
+      while (! pager -> pending && ! pager -> quit)
+	pthread_cond_wait (& pager -> wakeup, & pager -> lock);
+      if (pager -> quit)
+	break;
+
+      want     = pager -> want;
+      pagesize = pager -> pagesize;
+      pager -> pending = false;
+      pthread_mutex_unlock (& pager -> lock);
+
+      /* The shell changes the # of rows (filter) holding [fetch] */
+      pthread_mutex_lock (& pager -> fetch);
+      rssize = pager -> rssize;
+      pthread_mutex_unlock (& pager -> fetch);
+
+      /* Next pages first (the most likely direction), then the previous ones */
+      last = RMIN (rssize, want + (PAGER_AHEAD + 1) * pagesize - 1);
+      for (r = want + pagesize; r <= last && ! moved (pager); r ++)
+	load (pager, r);
+
+      first = want > PAGER_BEHIND * pagesize ? want - PAGER_BEHIND * pagesize : 1;
+      for (r = want - 1; r >= first && r < want && ! moved (pager); r --)
+	load (pager, r);
+
+      pthread_mutex_lock (& pager -> lock);
+    }
+  pthread_mutex_unlock (& pager -> lock);
+
+  return NULL;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* Allocate the cache for a viewer displaying [pagesize] rows of [rs] per page and start its worker */
+osh_pager_t * pager_alloc (unsigned rssize, OCI_Resultset * rs, unsigned pagesize)
+{
+  osh_pager_t * pager = calloc (1, sizeof (* pager));
+  OCI_Connection * handle = OCI_StatementGetConnection (OCI_ResultsetGetStatement (rs));
+  unsigned c;
+
+  pager -> rs       = rs;
+  pager -> rssize   = rssize;
+  pager -> total    = rssize;
+  pager -> cols     = OCI_GetColumnCount (rs);
+  pager -> pagesize = RMAX (1, pagesize);
+  pager -> capacity = PAGER_PAGES * pager -> pagesize;
+  pager -> ring     = calloc (pager -> capacity, sizeof (osh_row_t));
+
+  pager -> names    = calloc (pager -> cols + 1, sizeof (char *));
+  for (c = 0; c < pager -> cols; c ++)
+    pager -> names [c] = strdup ((char *) OCI_ColumnGetName (OCI_GetColumn (rs, c + 1)));
+  pager -> database = safedup ((char *) OCI_GetDatabase (handle));
+  pager -> user     = safedup ((char *) OCI_GetUserName (handle));
+  pager -> sql      = safedup ((char *) OCI_GetSql (OCI_ResultsetGetStatement (rs)));
+
+  pthread_mutex_init (& pager -> fetch, NULL);
+  pthread_mutex_init (& pager -> lock, NULL);
+  pthread_cond_init (& pager -> wakeup, NULL);
+
+  if (pthread_create (& pager -> worker, NULL, prefetch, pager))
+    pager -> quit = true;                    /* no prefetch: pages are fetched on demand */
+
+  return pager;
+}
+
+
+/* Allocate the cache for a viewer displaying [pagesize] rows per page of [rows] already in memory (they are moved) */
+osh_pager_t * pager_alloc_rows (osh_rows_t * rows, unsigned pagesize)
+{
+  osh_pager_t * pager = calloc (1, sizeof (* pager));
+  unsigned r;
+  unsigned c;
+
+  pager -> rssize   = rows -> n;
+  pager -> total    = rows -> n;
+  pager -> cols     = rows -> cols;
+  pager -> pagesize = RMAX (1, pagesize);
+  pager -> capacity = PAGER_PAGES * pager -> pagesize;
+  pager -> ring     = calloc (pager -> capacity, sizeof (osh_row_t));
+
+  pager -> names    = calloc (pager -> cols + 1, sizeof (char *));
+  for (c = 0; c < pager -> cols; c ++)
+    pager -> names [c] = safedup (rows -> names [c]);
+  pager -> database = safedup (rows -> database);
+  pager -> user     = safedup (rows -> user);
+  pager -> sql      = safedup (rows -> sql);
+
+  /* All the rows are already in memory, in their original order */
+  pager -> all   = rows -> rows;
+  pager -> keys  = rows -> keys;
+  pager -> perm  = calloc (pager -> total + 1, sizeof (unsigned));
+  pager -> order = calloc (pager -> total + 1, sizeof (unsigned));
+  for (r = 0; r < pager -> total; r ++)
+    pager -> perm [r] = pager -> order [r] = r;
+
+  rows -> rows = NULL;
+  rows -> keys = NULL;
+  rows -> n    = 0;
+  rows -> size = 0;
+
+  pthread_mutex_init (& pager -> fetch, NULL);
+  pthread_mutex_init (& pager -> lock, NULL);
+  pthread_cond_init (& pager -> wakeup, NULL);
+
+  /* Nothing to prefetch */
+  pager -> quit = true;
+
+  return pager;
+}
+
+
+/* Stop the worker and release the cache */
+void pager_free (osh_pager_t * pager)
+{
+  unsigned i;
+
+  if (! pager)
+    return;
+
+  pthread_mutex_lock (& pager -> lock);
+  if (! pager -> quit)
+    {
+      pager -> quit = true;
+      pthread_cond_signal (& pager -> wakeup);
+      pthread_mutex_unlock (& pager -> lock);
+      pthread_join (pager -> worker, NULL);
+    }
+  else
+    pthread_mutex_unlock (& pager -> lock);
+
+  for (i = 0; i < pager -> capacity; i ++)
+    slot_clear (& pager -> ring [i], pager -> cols);
+  free (pager -> ring);
+
+  if (pager -> all)
+    for (i = 0; i < pager -> total; i ++)
+      slot_clear (& pager -> all [i], pager -> cols);
+  safefree (pager -> all);
+  safefree (pager -> keys);
+  safefree (pager -> perm);
+  safefree (pager -> order);
+  safefree (pager -> filter);
+
+  for (i = 0; i < pager -> cols; i ++)
+    safefree (pager -> names [i]);
+  safefree (pager -> names);
+  safefree (pager -> database);
+  safefree (pager -> user);
+  safefree (pager -> sql);
+
+  pthread_cond_destroy (& pager -> wakeup);
+  pthread_mutex_destroy (& pager -> lock);
+  pthread_mutex_destroy (& pager -> fetch);
+  free (pager);
+}
+
+
+/* Distance between rows [a] and [b] */
+static unsigned distance (unsigned a, unsigned b)
+{
+  return a > b ? a - b : b - a;
+}
+
+
+/*
+ * Change the # of rows per page (eg. the window has been resized).
+ *
+ * The rows already in the ring are moved to their slots in a ring
+ * sized for the new pages, preferring those nearest to the page
+ * currently displayed when two of them map to the same slot.
+ */
+void pager_resize (osh_pager_t * pager, unsigned pagesize)
+{
+  osh_row_t * ring;
+  unsigned capacity;
+  unsigned i;
+
+  pagesize = RMAX (1, pagesize);
+
+  pthread_mutex_lock (& pager -> lock);
+  if (pagesize != pager -> pagesize)
+    {
+      capacity = PAGER_PAGES * pagesize;
+      ring     = calloc (capacity, sizeof (osh_row_t));
+
+      for (i = 0; i < pager -> capacity; i ++)
+	{
+	  osh_row_t * from = & pager -> ring [i];
+	  osh_row_t * to;
+
+	  if (! from -> rowno)
+	    continue;
+
+	  to = & ring [(from -> rowno - 1) % capacity];
+
+	  if (to -> rowno && distance (to -> rowno, pager -> want) <= distance (from -> rowno, pager -> want))
+	    slot_clear (from, pager -> cols);
+	  else
+	    {
+	      slot_clear (to, pager -> cols);
+	      * to = * from;
+	    }
+	}
+
+      free (pager -> ring);
+      pager -> ring     = ring;
+      pager -> capacity = capacity;
+      pager -> pagesize = pagesize;
+      pager -> want     = 0;                  /* the next request restarts the worker */
+    }
+  pthread_mutex_unlock (& pager -> lock);
+}
+
+
+/* Ask the worker to prefetch the pages around the one starting at row [offset] */
+void pager_prefetch (osh_pager_t * pager, unsigned offset)
+{
+  pthread_mutex_lock (& pager -> lock);
+  if (offset != pager -> want)
+    {
+      pager -> want    = offset;
+      pager -> pending = true;
+      pthread_cond_signal (& pager -> wakeup);
+    }
+  pthread_mutex_unlock (& pager -> lock);
+}
+
+
+/*
+ * Format [n] rows starting at row [offset] in lines (column names first).
+ *
+ * Rows are taken from the ring, fetching on demand only those not yet
+ * prefetched by the worker.  The byte offsets of the columns in each
+ * line are returned in [offsets] (see render_lines()).
+ */
+char ** pager_lines (osh_pager_t * pager, unsigned offset, unsigned n, size_t ** offsets)
+{
+  unsigned cols = pager -> cols + 1;          /* +1 to include serial */
+  char ** cells;
+  size_t * widths;
+  char ** argv = NULL;
+  char * serials;
+  unsigned rows;
+  unsigned r;
+  unsigned c;
+  bool complete = false;
+
+  * offsets = NULL;
+  if (! offset || offset > pager -> rssize)
+    return NULL;
+
+  rows    = RMIN (n, pager -> rssize - offset + 1);
+  cells   = calloc ((rows + 1) * cols, sizeof (char *));
+  widths  = calloc ((rows + 1) * cols, sizeof (size_t));
+  serials = calloc (rows, 16);
+
+  /* Table header */
+  for (c = 0; c < cols; c ++)
+    {
+      cells [c]  = ! c ? "#" : pager -> names [c - 1];
+      widths [c] = osh_width (cells [c]);
+    }
+
+  while (! complete)
+    {
+      rtime_t t1;
+
+      for (r = 0; r < rows; r ++)
+	load (pager, offset + r);
+
+      /* The worker may have reused a slot in the meantime, so check again while formatting */
+      t1 = nswall ();
+      pthread_mutex_lock (& pager -> lock);
+      for (r = 0, complete = true; r < rows && complete; r ++)
+	{
+	  osh_row_t * slot = & pager -> ring [(offset + r - 1) % pager -> capacity];
+
+	  complete = slot -> rowno == offset + r;
+	  if (complete)
+	    {
+	      /* The display widths were evaluated when the row was decoded */
+	      widths [(r + 1) * cols] = snprintf (serials + r * 16, 16, "%u", offset + r);
+	      cells [(r + 1) * cols]  = serials + r * 16;
+	      for (c = 1; c < cols; c ++)
+		{
+		  cells [(r + 1) * cols + c]  = slot -> values [c - 1];
+		  widths [(r + 1) * cols + c] = slot -> widths [c - 1];
+		}
+	    }
+	}
+      if (complete)
+	{
+	  * offsets = calloc ((rows + 1) * (cols + 1), sizeof (size_t));
+	  argv = render_lines (cells, widths, rows + 1, cols, * offsets);
+	}
+      pthread_mutex_unlock (& pager -> lock);
+      osh_timing_add (OSH_SPAN_FORMAT, nswall () - t1);
+    }
+
+  /* Memory cleanup */
+  free (serials);
+  free (widths);
+  free (cells);
+
+  return argv;
+}
+
+
+
+
+/*
+ * Return the first row after [from] (or the last one before it when
+ * ! [forward]) that contains [pattern] in any column (0 if none).
+ *
+ * The rows in memory next to [from] are scanned first, then the server
+ * is asked for the rows not yet fetched, so that the search never pages
+ * through the ResultSet.  Only if the server cannot run the search
+ * the remaining rows are fetched and scanned one by one.
+ */
+unsigned pager_search (osh_pager_t * pager, char * pattern, unsigned from, bool forward)
+{
+  size_t len     = strlen (pattern);
+  unsigned found = 0;
+  unsigned r     = from;
+
+  if (! len)
+    return 0;
+
+  /* All the rows are in memory (sorted and filtered) */
+  if (pager -> all)
+    {
+      pthread_mutex_lock (& pager -> fetch);
+      for (r = forward ? r + 1 : r - 1; ! found && r && r <= pager -> rssize; r = forward ? r + 1 : r - 1)
+	if (matches (pager -> all [pager -> order [r - 1]] . values, pager -> cols, pattern, len))
+	  found = r;
+      pthread_mutex_unlock (& pager -> fetch);
+
+      return found;
+    }
+
+  /* Rows already in memory */
+  pthread_mutex_lock (& pager -> lock);
+  while (! found)
+    {
+      osh_row_t * slot;
+
+      r = forward ? r + 1 : r - 1;
+      if (! r || r > pager -> rssize)
+	break;
+
+      slot = & pager -> ring [(r - 1) % pager -> capacity];
+      if (slot -> rowno != r)
+	break;
+
+      if (matches (slot -> values, pager -> cols, pattern, len))
+	found = r;
+    }
+  pthread_mutex_unlock (& pager -> lock);
+
+  if (found || ! r || r > pager -> rssize)
+    return found;
+
+  /* Rows not yet fetched (starting at [r]) */
+  pthread_mutex_lock (& pager -> fetch);
+  if (! ocilib_search (pager -> rs, pattern, forward ? r - 1 : r + 1, forward, & found))
+    for (; ! found && r && r <= pager -> rssize; r = forward ? r + 1 : r - 1)
+      if (ocilib_fetch (pager -> rs, r))
+	{
+	  unsigned c;
+
+	  for (c = 1; ! found && c <= pager -> cols; c ++)
+	    {
+	      char * value = ocilib_value (pager -> rs, c);
+	      if (value && memmem (value, strlen (value), pattern, len))
+		found = r;
+	    }
+	}
+  pthread_mutex_unlock (& pager -> fetch);
+
+  return found;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* A typed sort key of a row */
+typedef struct
+{
+  double number;          /* numbers and dates (NAN if NULL)        */
+  char * text;            /* everything else (NULL if NULL)         */
+  unsigned index;         /* index of the row in [all]              */
+
+} sortkey_t;
+
+
+/* Sort by numbers or by text (NULLs last in both directions, ties in original order) */
+static int cmp_keys (const void * _a, const void * _b, void * arg)
+{
+  const sortkey_t * a = _a;
+  const sortkey_t * b = _b;
+  int descending      = * (bool *) arg ? -1 : 1;
+  int cmp;
+
+  if (isnan (a -> number) && isnan (b -> number))
+    {
+      if (! a -> text || ! b -> text)
+	cmp = ! a -> text && ! b -> text ? 0 : ! a -> text ? 1 : -1;
+      else
+	cmp = descending * strcmp (a -> text, b -> text);
+    }
+  else if (isnan (a -> number) || isnan (b -> number))
+    cmp = isnan (a -> number) ? 1 : -1;
+  else
+    cmp = descending * (a -> number < b -> number ? -1 : a -> number > b -> number ? 1 : 0);
+
+  return cmp ? cmp : a -> index < b -> index ? -1 : a -> index > b -> index;
+}
+
+
+/*
+ * Read all the rows of the ResultSet in memory, decoded and with the
+ * typed keys of numbers and dates, in order to sort and filter them.
+ * Return false if there are too many rows.
+ */
+static bool materialize (osh_pager_t * pager)
+{
+  unsigned cols = pager -> cols;
+  unsigned * types;
+  unsigned r;
+  unsigned c;
+
+  if (pager -> all)
+    return true;
+
+  if (pager -> total > PAGER_MEMORY)
+    return false;
+
+  types = calloc (cols, sizeof (unsigned));
+  for (c = 0; c < cols; c ++)
+    types [c] = OCI_ColumnGetType (OCI_GetColumn (pager -> rs, c + 1));
+
+  pager -> all   = calloc (pager -> total, sizeof (osh_row_t));
+  pager -> keys  = calloc ((size_t) pager -> total * cols, sizeof (double));
+  pager -> perm  = calloc (pager -> total, sizeof (unsigned));
+  pager -> order = calloc (pager -> total, sizeof (unsigned));
+
+  for (r = 0; r < pager -> total; r ++)
+    {
+      osh_row_t * row = & pager -> all [r];
+
+      row -> rowno  = r + 1;
+      row -> values = calloc (cols, sizeof (char *));
+      pager -> perm [r] = pager -> order [r] = r;
+
+      if (ocilib_fetch (pager -> rs, r + 1))
+	for (c = 0; c < cols; c ++)
+	  {
+	    char * value = ocilib_value (pager -> rs, c + 1);
+	    row -> values [c] = value ? strdup (value) : NULL;
+	    pager -> keys [(size_t) r * cols + c] = ocilib_key (pager -> rs, c + 1, types [c]);
+	  }
+      else
+	for (c = 0; c < cols; c ++)
+	  pager -> keys [(size_t) r * cols + c] = NAN;
+    }
+
+  free (types);
+
+  return true;
+}
+
+
+/* Select the rows to display, in sort order, applying the filter (if any) */
+static void select_rows (osh_pager_t * pager)
+{
+  size_t len = pager -> filter ? strlen (pager -> filter) : 0;
+  unsigned n = 0;
+  unsigned i;
+
+  for (i = 0; i < pager -> total; i ++)
+    if (! len || matches (pager -> all [pager -> perm [i]] . values, pager -> cols, pager -> filter, len))
+      pager -> order [n ++] = pager -> perm [i];
+
+  pager -> rssize = n;
+}
+
+
+/* The rows have been reordered: forget those in the ring and those being loaded (called holding [fetch]) */
+static void reordered (osh_pager_t * pager)
+{
+  unsigned i;
+
+  pthread_mutex_lock (& pager -> lock);
+  for (i = 0; i < pager -> capacity; i ++)
+    slot_clear (& pager -> ring [i], pager -> cols);
+  pager -> generation ++;
+  pager -> want = 0;
+  pthread_mutex_unlock (& pager -> lock);
+}
+
+
+/*
+ * Sort the rows in memory by [column] (one-based) on the typed keys
+ * (numbers and dates are not compared as text), in parallel for large
+ * ResultSets.  Return false if the ResultSet is too large to be kept in
+ * memory (the caller should ask the server to sort it).
+ */
+bool pager_sort (osh_pager_t * pager, unsigned column, bool descending)
+{
+  sortkey_t * keys;
+  unsigned i;
+
+  if (! column || column > pager -> cols)
+    return false;
+
+  pthread_mutex_lock (& pager -> fetch);
+  if (! materialize (pager))
+    {
+      pthread_mutex_unlock (& pager -> fetch);
+      return false;
+    }
+
+  /* Precompute the keys once, then sort them */
+  keys = calloc (pager -> total, sizeof (sortkey_t));
+  for (i = 0; i < pager -> total; i ++)
+    {
+      keys [i] . number = pager -> keys [(size_t) i * pager -> cols + column - 1];
+      keys [i] . text   = pager -> all [i] . values [column - 1];
+      keys [i] . index  = i;
+    }
+
+  osh_sort (keys, pager -> total, sizeof (sortkey_t), cmp_keys, & descending);
+
+  for (i = 0; i < pager -> total; i ++)
+    pager -> perm [i] = keys [i] . index;
+  free (keys);
+
+  select_rows (pager);
+  reordered (pager);
+  pthread_mutex_unlock (& pager -> fetch);
+
+  return true;
+}
+
+
+/*
+ * Display only the rows containing [pattern] in any column (all of them
+ * if [pattern] is empty).  Return false if the ResultSet is too large
+ * to be kept in memory.
+ */
+bool pager_filter (osh_pager_t * pager, char * pattern)
+{
+  pthread_mutex_lock (& pager -> fetch);
+  if (! materialize (pager))
+    {
+      pthread_mutex_unlock (& pager -> fetch);
+      return false;
+    }
+
+  safefree (pager -> filter);
+  pager -> filter = pattern && * pattern ? strdup (pattern) : NULL;
+
+  select_rows (pager);
+  reordered (pager);
+  pthread_mutex_unlock (& pager -> fetch);
+
+  return true;
+}
@@ -30,7 +30,6 @@ static bool interrupted = false;
 static void on_ctrl_c (int signo)
 {
   interrupted = true;
-  fflush (stdout);
 }
 
 
@@ -38,8 +37,14 @@ static void on_ctrl_c (int signo)
 enum
 {
   /* Startup */
-  OPT_HELP  = 'h',
-  OPT_QUIET = 'q'
+  OPT_HELP    = 'h',
+  OPT_QUIET   = 'q',
+
+  /* Timing */
+  OPT_TIMING  = 'k',
+
+  /* Health monitor */
+  OPT_MONITOR = 'm'
 };
 
 
@@ -47,10 +52,16 @@ enum
 static struct option lopts [] =
 {
   /* Startup */
-  { "help",  no_argument, NULL, OPT_HELP  },
-  { "quiet", no_argument, NULL, OPT_QUIET },
+  { "help",    no_argument,       NULL, OPT_HELP    },
+  { "quiet",   no_argument,       NULL, OPT_QUIET   },
+
+  /* Timing */
+  { "timing",  no_argument,       NULL, OPT_TIMING  },
 
-  { NULL,    0,           NULL, 0         }
+  /* Health monitor */
+  { "monitor", required_argument, NULL, OPT_MONITOR },
+
+  { NULL,      0,                 NULL, 0           }
 };
 
 
@@ -65,8 +76,15 @@ static void usage (char * progname, struct option * options)
   printf ("\n");
 
   printf ("Startup:\n");
-  usage_item (options, n, OPT_HELP,  "show this help message and exit");
-  usage_item (options, n, OPT_QUIET, "run quietly");
+  usage_item (options, n, OPT_HELP,    "show this help message and exit");
+  usage_item (options, n, OPT_QUIET,   "run quietly");
+  printf ("\n");
+
+  usage_item (options, n, OPT_TIMING,  "show the client-side timing breakdown");
+  printf ("\n");
+
+  printf ("Health monitor:\n");
+  usage_item (options, n, OPT_MONITOR, "ping in background the connections idle for # seconds and connect again the dead ones (0 stops)");
 }
 
 
@@ -78,6 +96,8 @@ int osh_oping (int argc, char * argv [])
 
   /* Variables that are set according to the specified options */
   bool quiet      = false;
+  bool timing     = false;
+  int monitor     = -1;            /* seconds between pings of the health monitor */
 
   unsigned seq    = 0;
   rtime_t started;
@@ -111,11 +131,36 @@ int osh_oping (int argc, char * argv [])
 	default: if (! quiet) printf ("Try '%s --help' for more information.\n", progname); return 1;
 
 	  /* Startup */
-	case OPT_HELP:  usage (progname, lopts); return 0;
-	case OPT_QUIET: quiet = true;            break;
+	case OPT_HELP:    usage (progname, lopts); return 0;
+	case OPT_QUIET:   quiet = true;            break;
+
+	  /* Timing */
+	case OPT_TIMING:  timing = true;           break;
+
+	  /* Health monitor */
+	case OPT_MONITOR: monitor = atoi (optarg); break;
 	}
     }
 
+  /* Start (or stop) the health monitor in background */
+  if (monitor >= 0)
+    {
+      if (! osh_monitor_start (monitor))
+	{
+	  if (! quiet)
+	    printf ("%s: Cannot start the health monitor.\n", progname);
+	  return 1;
+	}
+      if (! quiet)
+	{
+	  if (monitor)
+	    printf ("%s: pinging the connections idle for %u seconds\n", progname, monitor);
+	  else
+	    printf ("%s: health monitor stopped\n", progname);
+	}
+      return 0;
+    }
+
   /* Check # of connections */
   if (! len_connections ())
     {
@@ -125,12 +170,13 @@ int osh_oping (int argc, char * argv [])
     }
 
   /* Ping server over current connection */
-  conn = get_current_connection ();
+  conn = get_active_connection ();
 
   /* Enable ^C */
   on_prev = signal (SIGINT, on_ctrl_c);
 
   /* Main loop - iterate to run ping and evaluate min/max/avg */
+  osh_timing_reset ();
   started = nswall ();
   while (! interrupted)
     {
@@ -140,6 +186,8 @@ int osh_oping (int argc, char * argv [])
 
       pinged = OCI_Ping (osh_connection_handle (conn));
       elapsed = nswall () - t1;
+      osh_timing_add (OSH_SPAN_EXECUTE, elapsed);
+      osh_timing_trips (1);
 
       /* Evaluate min/max/avg time elapsed */
       min = RMIN (min, elapsed);
@@ -155,7 +203,7 @@ int osh_oping (int argc, char * argv [])
       else
 	{
 	  if (! quiet)
-	    printf ("reply from %s: seq=%u time=%s\n", OCI_GetDatabase (osh_connection_handle (conn)), ++ seq, ns2a (elapsed));
+	    osh_progress ("reply from %s: seq=%u time=%s\n", OCI_GetDatabase (osh_connection_handle (conn)), ++ seq, ns2a (elapsed));
 	}
     }
   stopped = nswall ();
@@ -172,6 +220,10 @@ int osh_oping (int argc, char * argv [])
 	  avg / 1e6,
 	  ns2a (stopped - started));
 
+  /* Client-side timing breakdown */
+  if (osh_timing_enabled (timing))
+    osh_timing_print (progname);
+
   /* Re-enable ^C to its previous handler */
   signal (SIGINT, on_prev);
 
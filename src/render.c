@@ -0,0 +1,659 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* Project headers */
+#include "osh.h"
+
+
+/*
+ * Streaming renderers.
+ *
+ * Rows are formatted and written out as soon as they are fetched,
+ * so the memory in use does not depend on the size of the ResultSet.
+ */
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* Append a separator line (eg. +---+------+) */
+static void table_separator (osh_buf_t * line, unsigned * widths, unsigned cols)
+{
+  unsigned c;
+
+  for (c = 0; c < cols; c ++)
+    {
+      osh_buf_puts (line, "+");
+      osh_buf_pad (line, '-', widths [c] + 2);
+    }
+  osh_buf_puts (line, "+\n");
+}
+
+
+/* Append [value] left justified in a field of [width] columns, clipping it if too long and [clip] (only text sized on a sample) */
+static void table_cell (osh_buf_t * line, char * value, unsigned width, bool clip)
+{
+  size_t cols = 0;
+  size_t len  = value ? strlen (value) : 0;
+
+  if (value && clip)
+    len = osh_strclip (value, len, width, & cols);
+  else if (value)
+    cols = osh_strwidth (value, len);
+
+  osh_buf_puts (line, "| ");
+  osh_buf_cat (line, value, len);
+  osh_buf_pad (line, ' ', width > cols ? width - cols + 1 : 1);
+}
+
+
+/* Evaluate the column widths from the metadata or from a sample of the first [sample] rows */
+static unsigned * table_widths (unsigned rows, OCI_Resultset * rs, unsigned sample)
+{
+  unsigned cols     = OCI_GetColumnCount (rs) + 1;       /* +1 to include serial */
+  unsigned * widths = calloc (cols, sizeof (unsigned));
+  unsigned r;
+  unsigned c;
+
+  widths [0] = RMAX (1, digits (rows));
+  for (c = 1; c < cols; c ++)
+    widths [c] = sample ? osh_width (OCI_ColumnGetName (OCI_GetColumn (rs, c))) : ocilib_column_width (rs, c);
+
+  /* Size the columns on the longest values in the sample */
+  for (r = 1; r <= RMIN (sample, rows) && ocilib_fetch (rs, r); r ++)
+    for (c = 1; c < cols; c ++)
+      {
+	widths [c] = RMAX (widths [c], osh_width (ocilib_value (rs, c)));
+      }
+
+  return widths;
+}
+
+
+/*
+ * Render [n] rows (0 means all) of the ResultSet in a table.
+ *
+ * Column widths are evaluated once, then each row is written
+ * out as soon as it has been fetched.
+ */
+void render_table (unsigned rssize, OCI_Resultset * rs, unsigned n, unsigned sample)
+{
+  unsigned rows     = n ? RMIN (n, rssize) : rssize;
+  unsigned cols     = OCI_GetColumnCount (rs) + 1;       /* +1 to include serial */
+  unsigned * widths = table_widths (rows, rs, sample);
+  osh_buf_t sep     = { NULL, 0, 0 };
+  osh_buf_t line    = { NULL, 0, 0 };
+  unsigned r;
+  unsigned c;
+  rtime_t t1;
+
+  /* The separator line is the same for all the rows */
+  table_separator (& sep, widths, cols);
+
+  /* Table header */
+  osh_buf_cat (& line, sep . data, sep . len);
+  for (c = 0; c < cols; c ++)
+    table_cell (& line, ! c ? "#" : (char *) OCI_ColumnGetName (OCI_GetColumn (rs, c)), widths [c], false);
+  osh_buf_puts (& line, "|\n");
+  osh_buf_cat (& line, sep . data, sep . len);
+  osh_buf_write (& line, stdout);
+
+  /* Table body (stop fetching as soon as the reader has gone) */
+  for (r = 1; r <= rows && ! osh_output_broken () && ocilib_fetch (rs, r); r ++)
+    {
+      t1 = nswall ();
+      osh_buf_reset (& line);
+      table_cell (& line, utoa (r), widths [0], false);
+      for (c = 1; c < cols; c ++)
+	table_cell (& line, ocilib_value (rs, c), widths [c], sample && OCI_ColumnGetType (OCI_GetColumn (rs, c)) == OCI_CDT_TEXT);
+      osh_buf_puts (& line, "|\n");
+      osh_timing_add (OSH_SPAN_FORMAT, nswall () - t1);
+
+      t1 = nswall ();
+      osh_buf_write (& line, stdout);
+      osh_timing_add (OSH_SPAN_OUTPUT, nswall () - t1);
+    }
+
+  /* Table footer */
+  osh_buf_write (& sep, stdout);
+
+  /* Memory cleanup */
+  osh_buf_free (& line);
+  osh_buf_free (& sep);
+  free (widths);
+}
+
+
+/*
+ * Render [n] rows (0 means all) of the ResultSet one block per row,
+ * with one "column: value" line per column, eg.
+ *
+ * *************************** 1. row ***************************
+ *   ID: 1
+ * NAME: foo
+ *
+ * Column names are padded once, then each block is written out as
+ * soon as its row has been fetched.
+ */
+void render_vertical (unsigned rssize, OCI_Resultset * rs, unsigned n)
+{
+  unsigned rows     = n ? RMIN (n, rssize) : rssize;
+  unsigned cols     = OCI_GetColumnCount (rs);
+  osh_buf_t * names = calloc (cols + 1, sizeof (osh_buf_t));
+  osh_buf_t line    = { NULL, 0, 0 };
+  unsigned width    = 0;
+  unsigned r;
+  unsigned c;
+  rtime_t t1;
+
+  /* Right justify all the column names to the longest one */
+  for (c = 1; c <= cols; c ++)
+    width = RMAX (width, osh_width (OCI_ColumnGetName (OCI_GetColumn (rs, c))));
+
+  for (c = 1; c <= cols; c ++)
+    {
+      char * name = (char *) OCI_ColumnGetName (OCI_GetColumn (rs, c));
+      osh_buf_pad (& names [c], ' ', width - osh_width (name));
+      osh_buf_puts (& names [c], name);
+      osh_buf_puts (& names [c], ": ");
+    }
+
+  for (r = 1; r <= rows && ! osh_output_broken () && ocilib_fetch (rs, r); r ++)
+    {
+      t1 = nswall ();
+      osh_buf_reset (& line);
+      osh_buf_pad (& line, '*', 27);
+      osh_buf_puts (& line, " ");
+      osh_buf_puts (& line, utoa (r));
+      osh_buf_puts (& line, ". row ");
+      osh_buf_pad (& line, '*', 27);
+      osh_buf_puts (& line, "\n");
+
+      for (c = 1; c <= cols; c ++)
+	{
+	  osh_buf_cat (& line, names [c] . data, names [c] . len);
+	  osh_buf_puts (& line, ocilib_value (rs, c));
+	  osh_buf_puts (& line, "\n");
+	}
+      osh_timing_add (OSH_SPAN_FORMAT, nswall () - t1);
+
+      t1 = nswall ();
+      osh_buf_write (& line, stdout);
+      osh_timing_add (OSH_SPAN_OUTPUT, nswall () - t1);
+    }
+
+  /* Memory cleanup */
+  for (c = 1; c <= cols; c ++)
+    osh_buf_free (& names [c]);
+  free (names);
+  osh_buf_free (& line);
+}
+
+
+/* How to encode the values of a column in JSON */
+enum
+{
+  JSON_NULL,
+  JSON_INTEGER,
+  JSON_NUMBER,
+  JSON_DOUBLE,
+  JSON_DATE,
+  JSON_TEXT
+};
+
+
+/*
+ * Choose once per column the typed decoder to use.  Only integers that
+ * fit in 64 bits and binary floating point numbers are decoded as such,
+ * any other NUMBER (eg. with no declared precision, as COUNT(*)) is
+ * written with all the digits of its text.
+ */
+static unsigned json_kind (OCI_Column * col)
+{
+  switch (OCI_ColumnGetType (col))
+    {
+    case OCI_CDT_NUMERIC:
+      if (OCI_ColumnGetSubType (col) == OCI_NUM_FLOAT || OCI_ColumnGetSubType (col) == OCI_NUM_DOUBLE)
+	return JSON_DOUBLE;
+      return OCI_ColumnGetScale (col) == 0 && OCI_ColumnGetPrecision (col) > 0 && OCI_ColumnGetPrecision (col) <= 18 ? JSON_INTEGER : JSON_NUMBER;
+    case OCI_CDT_DATETIME: return JSON_DATE;
+    case OCI_CDT_TEXT:     return JSON_TEXT;
+    default:               return JSON_NULL;
+    }
+}
+
+
+/* Append the value at column [c] of the current row in [rs] */
+static void json_value (osh_buf_t * line, OCI_Resultset * rs, unsigned c, unsigned kind)
+{
+  char * text;
+  int y, m, d, hh, mm, ss;
+
+  if (kind == JSON_NULL || OCI_IsNull (rs, c))
+    {
+      osh_buf_cat (line, "null", 4);
+      return;
+    }
+
+  switch (kind)
+    {
+    case JSON_INTEGER: json_integer (line, OCI_GetBigInt (rs, c));           break;
+    case JSON_NUMBER:  json_number (line, (char *) OCI_GetString (rs, c));  break;
+    case JSON_DOUBLE:  json_double (line, OCI_GetDouble (rs, c));            break;
+
+    case JSON_DATE:
+      if (OCI_DateGetDateTime (OCI_GetDate (rs, c), & y, & m, & d, & hh, & mm, & ss))
+	json_date (line, y, m, d, hh, mm, ss);
+      else
+	osh_buf_cat (line, "null", 4);
+      break;
+
+    case JSON_TEXT:
+      text = (char *) OCI_GetString (rs, c);
+      json_string (line, text, strlen (text));
+      break;
+    }
+}
+
+
+/*
+ * Render [n] rows (0 means all) of the ResultSet in JSON, either one
+ * object per line (JSON Lines) or an array of objects.
+ *
+ * Numbers and dates come from the typed decoders and the keys are
+ * encoded once, then each object is written out as soon as its row
+ * has been fetched.
+ */
+void render_json (unsigned rssize, OCI_Resultset * rs, unsigned n, bool lines)
+{
+  unsigned rows    = n ? RMIN (n, rssize) : rssize;
+  unsigned cols    = OCI_GetColumnCount (rs);
+  osh_buf_t * keys = calloc (cols + 1, sizeof (osh_buf_t));
+  unsigned * kinds = calloc (cols + 1, sizeof (unsigned));
+  osh_buf_t line   = { NULL, 0, 0 };
+  unsigned r;
+  unsigned c;
+  rtime_t t1;
+
+  /* Keys and decoders are the same for all the rows */
+  for (c = 1; c <= cols; c ++)
+    {
+      char * name = (char *) OCI_ColumnGetName (OCI_GetColumn (rs, c));
+      osh_buf_puts (& keys [c], c == 1 ? "{" : ",");
+      json_string (& keys [c], name, strlen (name));
+      osh_buf_puts (& keys [c], ":");
+      kinds [c] = json_kind (OCI_GetColumn (rs, c));
+    }
+
+  if (! lines)
+    fputs ("[\n", stdout);
+
+  for (r = 1; r <= rows && ! osh_output_broken () && ocilib_fetch (rs, r); r ++)
+    {
+      t1 = nswall ();
+      osh_buf_reset (& line);
+      if (! lines && r > 1)
+	osh_buf_cat (& line, ",\n", 2);
+      for (c = 1; c <= cols; c ++)
+	{
+	  osh_buf_cat (& line, keys [c] . data, keys [c] . len);
+	  json_value (& line, rs, c, kinds [c]);
+	}
+      osh_buf_puts (& line, cols ? "}" : "{}");
+      if (lines)
+	osh_buf_cat (& line, "\n", 1);
+      osh_timing_add (OSH_SPAN_FORMAT, nswall () - t1);
+
+      t1 = nswall ();
+      osh_buf_write (& line, stdout);
+      osh_timing_add (OSH_SPAN_OUTPUT, nswall () - t1);
+    }
+
+  if (! lines)
+    fputs (rows ? "\n]\n" : "]\n", stdout);
+
+  /* Memory cleanup */
+  for (c = 1; c <= cols; c ++)
+    osh_buf_free (& keys [c]);
+  free (keys);
+  free (kinds);
+  osh_buf_free (& line);
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/*
+ * Rows that come one at a time (eg. merged from many connections) are
+ * written out as soon as they arrive, except the first [sample] rows
+ * of a table, which are kept to size its columns.
+ */
+
+
+/* Append the value of a column in memory (numbers with all the digits of their text) */
+static void json_cell (osh_buf_t * line, char * value, double key, unsigned type)
+{
+  int y, m, d, hh, mm, ss;
+
+  if (! value)
+    {
+      osh_buf_cat (line, "null", 4);
+      return;
+    }
+
+  switch (type)
+    {
+    case OCI_CDT_NUMERIC:
+      json_number (line, value);
+      break;
+
+    case OCI_CDT_DATETIME:
+      if (sscanf (value, "%d-%d-%d %d:%d:%d", & y, & m, & d, & hh, & mm, & ss) == 6)
+	json_date (line, y, m, d, hh, mm, ss);
+      else
+	osh_buf_cat (line, "null", 4);
+      break;
+
+    default:
+      json_string (line, value, strlen (value));
+      break;
+    }
+}
+
+
+/* Write out the next row of [stream] */
+static void stream_line (osh_stream_t * stream, char * values [], double keys [])
+{
+  osh_buf_t * line = & stream -> line;
+  unsigned cols    = stream -> head -> cols;
+  unsigned r       = ++ stream -> n;
+  unsigned c;
+  rtime_t t1       = nswall ();
+
+  osh_buf_reset (line);
+  switch (stream -> format)
+    {
+    case OSH_RENDER_TABLE:
+      table_cell (line, utoa (r), stream -> widths [0], false);
+      for (c = 0; c < cols; c ++)
+	table_cell (line, values [c], stream -> widths [c + 1], stream -> head -> types [c] == OCI_CDT_TEXT);
+      osh_buf_puts (line, "|\n");
+      break;
+
+    case OSH_RENDER_VERTICAL:
+      osh_buf_pad (line, '*', 27);
+      osh_buf_puts (line, " ");
+      osh_buf_puts (line, utoa (r));
+      osh_buf_puts (line, ". row ");
+      osh_buf_pad (line, '*', 27);
+      osh_buf_puts (line, "\n");
+      for (c = 0; c < cols; c ++)
+	{
+	  osh_buf_cat (line, stream -> labels [c] . data, stream -> labels [c] . len);
+	  osh_buf_puts (line, values [c]);
+	  osh_buf_puts (line, "\n");
+	}
+      break;
+
+    case OSH_RENDER_JSON:
+    case OSH_RENDER_JSONL:
+      if (stream -> format == OSH_RENDER_JSON && r > 1)
+	osh_buf_cat (line, ",\n", 2);
+      for (c = 0; c < cols; c ++)
+	{
+	  osh_buf_cat (line, stream -> labels [c] . data, stream -> labels [c] . len);
+	  json_cell (line, values [c], keys [c], stream -> head -> types [c]);
+	}
+      osh_buf_puts (line, cols ? "}" : "{}");
+      if (stream -> format == OSH_RENDER_JSONL)
+	osh_buf_cat (line, "\n", 1);
+      break;
+    }
+  osh_timing_add (OSH_SPAN_FORMAT, nswall () - t1);
+
+  t1 = nswall ();
+  osh_buf_write (line, stdout);
+  osh_timing_add (OSH_SPAN_OUTPUT, nswall () - t1);
+}
+
+
+/* Size the table on the rows kept so far ([total] if they are all, 0 if more are coming), then write them out */
+static void stream_table (osh_stream_t * stream, unsigned total)
+{
+  osh_rows_t * head = stream -> head;
+  unsigned cols     = head -> cols + 1;                  /* +1 to include serial */
+  unsigned r;
+  unsigned c;
+
+  /* Room for up to a million rows when the total is not known yet */
+  stream -> widths = calloc (cols, sizeof (unsigned));
+  stream -> widths [0] = RMAX (1, digits (total ? total : 999999));
+  for (c = 1; c < cols; c ++)
+    stream -> widths [c] = osh_width (head -> names [c - 1]);
+  for (r = 0; r < head -> n; r ++)
+    for (c = 1; c < cols; c ++)
+      stream -> widths [c] = RMAX (stream -> widths [c], osh_width (head -> rows [r] . values [c - 1]));
+
+  /* The separator line is the same for all the rows */
+  table_separator (& stream -> sep, stream -> widths, cols);
+
+  /* Table header */
+  osh_buf_reset (& stream -> line);
+  osh_buf_cat (& stream -> line, stream -> sep . data, stream -> sep . len);
+  for (c = 0; c < cols; c ++)
+    table_cell (& stream -> line, ! c ? "#" : head -> names [c - 1], stream -> widths [c], false);
+  osh_buf_puts (& stream -> line, "|\n");
+  osh_buf_cat (& stream -> line, stream -> sep . data, stream -> sep . len);
+  osh_buf_write (& stream -> line, stdout);
+
+  /* The rows kept, which are no longer needed */
+  for (r = 0; r < head -> n; r ++)
+    {
+      if (! osh_output_broken ())
+	stream_line (stream, head -> rows [r] . values, head -> keys + (size_t) r * head -> cols);
+      for (c = 0; c < head -> cols; c ++)
+	safefree (head -> rows [r] . values [c]);
+      safefree (head -> rows [r] . values);
+    }
+  head -> n = 0;
+}
+
+
+/* Start to render rows of [cols] columns [names] of [types] in [format] (tables are sized on the first [sample] rows, 0 means all) */
+osh_stream_t * render_stream_begin (osh_render_t format, unsigned cols, char * names [], unsigned types [], unsigned sample)
+{
+  osh_stream_t * stream = calloc (1, sizeof (osh_stream_t));
+  unsigned width        = 0;
+  unsigned c;
+
+  stream -> format = format;
+  stream -> head   = osh_rows_alloc (cols, names, types);
+  stream -> sample = sample;
+  stream -> labels = calloc (cols + 1, sizeof (osh_buf_t));
+
+  switch (format)
+    {
+    case OSH_RENDER_TABLE:
+      break;
+
+    case OSH_RENDER_VERTICAL:
+      /* Right justify all the column names to the longest one */
+      for (c = 0; c < cols; c ++)
+	width = RMAX (width, osh_width (names [c]));
+      for (c = 0; c < cols; c ++)
+	{
+	  osh_buf_pad (& stream -> labels [c], ' ', width - osh_width (names [c]));
+	  osh_buf_puts (& stream -> labels [c], names [c]);
+	  osh_buf_puts (& stream -> labels [c], ": ");
+	}
+      break;
+
+    case OSH_RENDER_JSON:
+    case OSH_RENDER_JSONL:
+      /* Keys are encoded once */
+      for (c = 0; c < cols; c ++)
+	{
+	  osh_buf_puts (& stream -> labels [c], ! c ? "{" : ",");
+	  json_string (& stream -> labels [c], names [c], strlen (names [c]));
+	  osh_buf_puts (& stream -> labels [c], ":");
+	}
+      if (format == OSH_RENDER_JSON)
+	fputs ("[\n", stdout);
+      break;
+    }
+
+  return stream;
+}
+
+
+/* Render the next row of [values] and typed [keys] (left to the caller); return false once the reader has gone */
+bool render_stream_row (osh_stream_t * stream, char * values [], double keys [])
+{
+  osh_rows_t * head = stream -> head;
+  unsigned c;
+
+  if (osh_output_broken ())
+    return false;
+
+  /* Keep the first rows of a table to size its columns */
+  if (stream -> format == OSH_RENDER_TABLE && ! stream -> widths)
+    {
+      char ** copy  = calloc (head -> cols + 1, sizeof (char *));
+      double * dups = calloc (head -> cols + 1, sizeof (double));
+
+      for (c = 0; c < head -> cols; c ++)
+	{
+	  copy [c] = safedup (values [c]);
+	  dups [c] = keys [c];
+	}
+      osh_rows_add (head, copy, dups);
+
+      if (head -> n == stream -> sample)                    /* never if 0 */
+	stream_table (stream, 0);
+    }
+  else
+    stream_line (stream, values, keys);
+
+  return ! osh_output_broken ();
+}
+
+
+/* Write out what is left of the rendering and release [stream]; return the # of rows rendered */
+unsigned render_stream_end (osh_stream_t * stream)
+{
+  unsigned n;
+  unsigned c;
+
+  if (stream -> format == OSH_RENDER_TABLE && ! stream -> widths && stream -> head -> n)
+    stream_table (stream, stream -> head -> n);
+
+  /* Footer */
+  if (stream -> format == OSH_RENDER_TABLE && stream -> widths)
+    osh_buf_write (& stream -> sep, stdout);
+  else if (stream -> format == OSH_RENDER_JSON)
+    fputs (stream -> n ? "\n]\n" : "]\n", stdout);
+
+  n = stream -> n;
+
+  /* Memory cleanup */
+  for (c = 0; c < stream -> head -> cols; c ++)
+    osh_buf_free (& stream -> labels [c]);
+  free (stream -> labels);
+  osh_rows_free (stream -> head);
+  safefree (stream -> widths);
+  osh_buf_free (& stream -> sep);
+  osh_buf_free (& stream -> line);
+  free (stream);
+
+  return n;
+}
+
+
+/* Render [n] rows (0 means all) already in memory in [format] (tables sized on all their values) */
+void render_rows (osh_rows_t * mem, unsigned n, osh_render_t format)
+{
+  unsigned rows         = n ? RMIN (n, mem -> n) : mem -> n;
+  osh_stream_t * stream = render_stream_begin (format, mem -> cols, mem -> names, mem -> types, 0);
+  unsigned r;
+
+  for (r = 0; r < rows && render_stream_row (stream, mem -> rows [r] . values, mem -> keys + (size_t) r * mem -> cols); r ++)
+    ;
+
+  render_stream_end (stream);
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/*
+ * Format a page of [rows] x [cols] cells (row-major order) in lines
+ * of left justified columns (eg. | 1 | foo | bar |).
+ *
+ * Column widths are evaluated once per page and each line is built
+ * in a single growable buffer, so there is no limit to its length.
+ * Byte lengths and display widths of the cells are evaluated once
+ * and kept side by side while padding.  The display widths can be
+ * given in [widths] (same layout of [cells]) when already known.
+ *
+ * If [offsets] is not NULL it is filled with the byte offset where
+ * each column starts in each line ([rows] x ([cols] + 1), the last
+ * one of each line is its length), in order to slice the lines later.
+ */
+char ** render_lines (char * cells [], size_t widths [], unsigned rows, unsigned cols, size_t * offsets)
+{
+  char ** argv      = NULL;
+  size_t * maxes    = calloc (cols, sizeof (size_t));
+  size_t * lens     = calloc (rows * cols + 1, sizeof (size_t));
+  size_t * sizes    = widths ? widths : calloc (rows * cols + 1, sizeof (size_t));
+  osh_buf_t line    = { NULL, 0, 0 };
+  unsigned r;
+  unsigned c;
+
+  /* Length and display width of each cell and width of each column */
+  for (r = 0; r < rows; r ++)
+    for (c = 0; c < cols; c ++)
+      {
+	char * cell = cells [r * cols + c];
+	lens [r * cols + c] = cell ? strlen (cell) : 0;
+	if (! widths)
+	  sizes [r * cols + c] = cell ? osh_strwidth (cell, lens [r * cols + c]) : 0;
+	maxes [c] = RMAX (maxes [c], sizes [r * cols + c]);
+      }
+
+  /* Pad each cell to the width of its column */
+  for (r = 0; r < rows; r ++)
+    {
+      osh_buf_reset (& line);
+      osh_buf_puts (& line, "|");
+      for (c = 0; c < cols; c ++)
+	{
+	  if (offsets)
+	    offsets [r * (cols + 1) + c] = line . len - 1;
+	  osh_buf_pad (& line, ' ', 1);
+	  osh_buf_cat (& line, cells [r * cols + c], lens [r * cols + c]);
+	  osh_buf_pad (& line, ' ', maxes [c] - sizes [r * cols + c] + 1);
+	  osh_buf_puts (& line, "|");
+	}
+      if (offsets)
+	offsets [r * (cols + 1) + cols] = line . len;
+      argv = argsmore (argv, line . data);
+    }
+
+  /* Memory cleanup */
+  osh_buf_free (& line);
+  if (! widths)
+    free (sizes);
+  free (lens);
+  free (maxes);
+
+  return argv;
+}
@@ -26,16 +26,27 @@ osh_command_t cmd_select = { NAME, BRIEF, SYNOPSIS, DESCRIPTION, osh_select };
 enum
 {
   /* Startup */
-  OPT_HELP   = 'h',
-  OPT_QUIET  = 'q',
+  OPT_HELP     = 'h',
+  OPT_QUIET    = 'q',
 
   /* ResultSet size */
-  OPT_RSSIZE = 'n',
+  OPT_RSSIZE   = 'n',
+  OPT_SAMPLE   = 's',
+
+  /* Watch mode */
+  OPT_WATCH    = 'w',
+
+  /* Timing */
+  OPT_TIMING   = 'k',
 
   /* Output formats */
-  OPT_TABLE  = 'm',
-  OPT_TREE   = 't',
-  OPT_CURSES = 'c'
+  OPT_TABLE    = 'm',
+  OPT_TREE     = 't',
+  OPT_VERTICAL = 'v',
+  OPT_JSON     = 'j',
+  OPT_JSONL    = 'J',
+  OPT_CURSES   = 'c',
+  OPT_FORMAT   = 'f'
 };
 
 
@@ -43,18 +54,29 @@ enum
 static struct option lopts [] =
 {
   /* Startup */
-  { "help",   no_argument,       NULL, OPT_HELP   },
-  { "quiet",  no_argument,       NULL, OPT_QUIET  },
+  { "help",     no_argument,       NULL, OPT_HELP     },
+  { "quiet",    no_argument,       NULL, OPT_QUIET    },
 
   /* ResultSet size */
-  { "size",   required_argument, NULL, OPT_RSSIZE },
+  { "size",     required_argument, NULL, OPT_RSSIZE   },
+  { "sample",   required_argument, NULL, OPT_SAMPLE   },
 
-  /* Output formats */
-  { "table",  no_argument,       NULL, OPT_TABLE  },
-  { "tree",   no_argument,       NULL, OPT_TREE   },
-  { "curses", no_argument,       NULL, OPT_CURSES },
+  /* Watch mode */
+  { "watch",    required_argument, NULL, OPT_WATCH    },
 
-  { NULL,     0,                 NULL, 0          }
+  /* Timing */
+  { "timing",   no_argument,       NULL, OPT_TIMING   },
+
+  /* Output formats */
+  { "table",    no_argument,       NULL, OPT_TABLE    },
+  { "tree",     no_argument,       NULL, OPT_TREE     },
+  { "vertical", no_argument,       NULL, OPT_VERTICAL },
+  { "json",     no_argument,       NULL, OPT_JSON     },
+  { "jsonl",    no_argument,       NULL, OPT_JSONL    },
+  { "curses",   no_argument,       NULL, OPT_CURSES   },
+  { "format",   required_argument, NULL, OPT_FORMAT   },
+
+  { NULL,       0,                 NULL, 0            }
 };
 
 
@@ -69,35 +91,61 @@ static void usage (char * progname, struct option * options)
   printf ("\n");
 
   printf ("Startup:\n");
-  usage_item (options, n, OPT_HELP,   "show this help message and exit");
-  usage_item (options, n, OPT_QUIET,  "run quietly");
+  usage_item (options, n, OPT_HELP,     "show this help message and exit");
+  usage_item (options, n, OPT_QUIET,    "run quietly");
   printf ("\n");
 
   /* ResultSet size */
-  usage_item (options, n, OPT_RSSIZE, "# of records to display (0 means all)");
+  usage_item (options, n, OPT_RSSIZE,   "# of records to display (0 means all)");
+  usage_item (options, n, OPT_SAMPLE,   "# of records to size the table columns (0 means use the metadata)");
+  printf ("\n");
+
+  /* Watch mode */
+  usage_item (options, n, OPT_WATCH,    "execute again every # seconds and show what changed (table or curses, until ^C)");
+  printf ("\n");
+
+  /* Timing */
+  usage_item (options, n, OPT_TIMING,   "show the client-side timing breakdown");
   printf ("\n");
 
   /* Output formats */
-  usage_item (options, n, OPT_TABLE,  "display in a formatted table");
-  usage_item (options, n, OPT_TREE,   "display in a tree");
-  usage_item (options, n, OPT_CURSES, "display in a window");
+  usage_item (options, n, OPT_TABLE,    "display in a formatted table");
+  usage_item (options, n, OPT_TREE,     "display in a tree");
+  usage_item (options, n, OPT_VERTICAL, "display one block per record");
+  usage_item (options, n, OPT_JSON,     "display in a JSON array of objects");
+  usage_item (options, n, OPT_JSONL,    "display in JSON Lines, one object per record");
+  usage_item (options, n, OPT_CURSES,   "display in a window");
+  usage_item (options, n, OPT_FORMAT,   "display in the given format (table, tree, vertical, json, jsonl, curses)");
 }
 
 
-/* Query Database and get records in a table */
-static void print_table (unsigned rssize, OCI_Resultset * rs, unsigned n)
+/* Map the name of an output format to its option */
+static int format_by_name (char * name)
 {
-  if (rssize)
-    {
-      /* Fill the ResulSet in a matrix */
-      mx_t * mx = rstomx (rssize, rs, n, 1);
+  struct option * o;
 
-      /* Print the data */
-      mxprint (mx);
+  for (o = lopts; o -> name; o ++)
+    if (! strcmp (o -> name, name))
+      switch (o -> val)
+	{
+	case OPT_TABLE:
+	case OPT_TREE:
+	case OPT_VERTICAL:
+	case OPT_JSON:
+	case OPT_JSONL:
+	case OPT_CURSES:
+	  return o -> val;
+	}
+  return 0;
+}
 
-      /* Memory cleanup */
-      mxfree (mx);
-    }
+
+/* Query Database and get records in a table */
+static void print_table (unsigned rssize, OCI_Resultset * rs, unsigned n, unsigned sample)
+{
+  /* Stream the rows as they are fetched */
+  if (rssize)
+    render_table (rssize, rs, n, sample);
 }
 
 
@@ -105,11 +153,14 @@ static void print_table (unsigned rssize, OCI_Resultset * rs, unsigned n)
 static void print_tree (unsigned rssize, OCI_Resultset * rs, unsigned n)
 {
   GNode * root = rstotree (rssize, rs, n);
+  rtime_t t1;
 
   if (root)
     {
       /* Print the data */
+      t1 = nswall ();
       g_node_hprint_rosetta (root);
+      osh_timing_add (OSH_SPAN_OUTPUT, nswall () - t1);
 
       /* Memory cleanup */
       g_node_no_more (root);
@@ -118,6 +169,23 @@ static void print_tree (unsigned rssize, OCI_Resultset * rs, unsigned n)
 }
 
 
+/* Query Database and get records one block per record */
+static void print_vertical (unsigned rssize, OCI_Resultset * rs, unsigned n)
+{
+  /* Stream the rows as they are fetched */
+  if (rssize)
+    render_vertical (rssize, rs, n);
+}
+
+
+/* Query Database and get records in JSON */
+static void print_json (unsigned rssize, OCI_Resultset * rs, unsigned n, bool lines)
+{
+  /* Stream the rows as they are fetched */
+  render_json (rssize, rs, n, lines);
+}
+
+
 /* The [select] command */
 int osh_select (int argc, char * argv [])
 {
@@ -127,7 +195,10 @@ int osh_select (int argc, char * argv [])
   /* Variables that are set according to the specified options */
   bool quiet      = false;
   unsigned wsize  = 0;             /* how many records to display */
+  unsigned sample = 0;             /* how many records to size the columns */
   unsigned fmt    = OPT_TABLE;
+  bool timing     = false;
+  unsigned watch  = 0;             /* seconds between runs */
 
   osh_connection_t * conn;
   unsigned i;
@@ -155,19 +226,50 @@ int osh_select (int argc, char * argv [])
 	default: if (! quiet) printf ("Try '%s --help' for more information.\n", progname); return 1;
 
 	  /* Startup */
-	case OPT_HELP:   usage (progname, lopts); return 0;
-	case OPT_QUIET:  quiet = true;            break;
+	case OPT_HELP:     usage (progname, lopts); return 0;
+	case OPT_QUIET:    quiet = true;            break;
 
 	  /* ResultSet size */
-	case OPT_RSSIZE: wsize = atoi (optarg);   break;
+	case OPT_RSSIZE:   wsize = atoi (optarg);   break;
+	case OPT_SAMPLE:   sample = atoi (optarg);  break;
+
+	  /* Watch mode */
+	case OPT_WATCH:    watch = atoi (optarg);   break;
+
+	  /* Timing */
+	case OPT_TIMING:   timing = true;           break;
 
 	  /* Output formats */
-	case OPT_TABLE:  fmt = option;            break;
-	case OPT_TREE:   fmt = option;            break;
-	case OPT_CURSES: fmt = option;            break;
+	case OPT_TABLE:    fmt = option;            break;
+	case OPT_TREE:     fmt = option;            break;
+	case OPT_VERTICAL: fmt = option;            break;
+	case OPT_JSON:     fmt = option;            break;
+	case OPT_JSONL:    fmt = option;            break;
+	case OPT_CURSES:   fmt = option;            break;
+
+	case OPT_FORMAT:
+	  if (! (fmt = format_by_name (optarg)))
+	    {
+	      if (! quiet)
+		printf ("%s: Unknown output format [%s].\n", progname, optarg);
+	      return 1;
+	    }
+	  break;
 	}
     }
 
+  /* Only the table and the window can show what changed */
+  if (watch && fmt != OPT_TABLE && fmt != OPT_CURSES)
+    {
+      if (! quiet)
+	printf ("%s: --watch requires the table or curses format.\n", progname);
+      return 1;
+    }
+
+  /* Keep machine readable formats clean of progress messages */
+  if (fmt == OPT_JSON || fmt == OPT_JSONL)
+    quiet = true;
+
   /* Check # of connections */
   if (! len_connections ())
     {
@@ -189,7 +291,7 @@ int osh_select (int argc, char * argv [])
     }
 
   /* Select records over current connection */
-  conn = get_current_connection ();
+  conn = get_active_connection ();
 
   /* Built the query from remaining non-option arguments */
   i = 1;
@@ -200,14 +302,20 @@ int osh_select (int argc, char * argv [])
 
   /* Retrieve a scrollable ResultSet */
   if (! quiet)
-    printf ("%s: querying for [%s] ... ", progname, query);
+    osh_progress ("%s: querying for [%s] ... ", progname, query);
 
   /* Do the job */
+  osh_timing_reset ();
   t1 = nswall ();
   rs = ocilib_scrollable_resultset (conn, query);
   if (! rs)
     {
-      printf ("failed - [%s]\n", osh_connection_error (conn));
+      /* Machine readable formats keep their errors out of the stream of records */
+      if (fmt == OPT_JSON || fmt == OPT_JSONL)
+	fprintf (stderr, "%s: query failed - [%s]\n", progname, osh_connection_error (conn));
+      else
+	printf ("failed - [%s]\n", osh_connection_error (conn));
+      safefree (query);
       return 1;
     }
 
@@ -218,18 +326,35 @@ int osh_select (int argc, char * argv [])
     printf ("Ok! #%u records found in %s\n", rssize, ns2a (nswall () - t1));
 
   /* Render the ResulSet in one of available format */
-  if (rssize)
+  if (watch)
+    {
+      /* The same Statement is executed again at each run, with no parse */
+      if (fmt == OPT_CURSES)
+	watch_curses (rs, wsize, watch, OSH_PACKAGE, OSH_VERSION);
+      else
+	watch_table (rs, wsize, watch);
+    }
+  else if (rssize)
     {
       switch (fmt)
 	{
-	case OPT_TABLE:  print_table (rssize, rs, wsize);                                            break;
-	case OPT_TREE:   print_tree (rssize, rs, wsize);                                             break;
-	case OPT_CURSES: print_curses (wsize ? wsize : rssize, rs, wsize, OSH_PACKAGE, OSH_VERSION); break;
+	case OPT_TABLE:    print_table (rssize, rs, wsize, sample);                                    break;
+	case OPT_TREE:     print_tree (rssize, rs, wsize);                                             break;
+	case OPT_VERTICAL: print_vertical (rssize, rs, wsize);                                         break;
+	case OPT_JSON:     print_json (rssize, rs, wsize, false);                                      break;
+	case OPT_JSONL:    print_json (rssize, rs, wsize, true);                                       break;
+	case OPT_CURSES:   print_curses (wsize ? wsize : rssize, rs, wsize, OSH_PACKAGE, OSH_VERSION); break;
 	}
     }
+  else if (fmt == OPT_JSON)
+    print_json (rssize, rs, wsize, false);                 /* an empty array */
   else if (! quiet)
     printf ("%s: no data to display\n", progname);
 
+  /* Client-side timing breakdown */
+  if (osh_timing_enabled (timing))
+    osh_timing_print (progname);
+
   safefree (query);
 
   /* Bye bye! */
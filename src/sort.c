@@ -0,0 +1,157 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* Project headers */
+#define _GNU_SOURCE
+#include "osh.h"
+
+
+/*
+ * Parallel sort of arrays in memory.
+ *
+ * The array is split in one chunk per CPU, the chunks are sorted by
+ * qsort_r() in their own threads and then merged two by two, again
+ * in parallel, until a single sorted run is left.
+ */
+
+
+/* Arrays shorter than this are sorted by the calling thread only */
+#define SORT_PARALLEL  65536
+
+/* Max # of threads */
+#define SORT_THREADS   8
+
+
+/* A run of elements to sort or to merge with the next one */
+typedef struct
+{
+  char * base;            /* the elements                          */
+  size_t n;               /* # of elements in the first run        */
+  size_t m;               /* # of elements in the second run       */
+  size_t size;            /* size of each element                  */
+  char * tmp;             /* where to merge the two runs           */
+  osh_cmp_t cmp;
+  void * arg;
+
+} run_t;
+
+
+/* Sort a run */
+static void * sort_run (void * arg)
+{
+  run_t * run = arg;
+
+  qsort_r (run -> base, run -> n, run -> size, run -> cmp, run -> arg);
+
+  return NULL;
+}
+
+
+/* Merge two adjacent sorted runs (the first one wins on ties, so the sort is stable if qsort_r is) */
+static void * merge_runs (void * arg)
+{
+  run_t * run = arg;
+  char * a    = run -> base;
+  char * b    = run -> base + run -> n * run -> size;
+  char * ea   = b;
+  char * eb   = b + run -> m * run -> size;
+  char * out  = run -> tmp;
+
+  while (a < ea && b < eb)
+    if (run -> cmp (b, a, run -> arg) < 0)
+      memcpy (out, b, run -> size), out += run -> size, b += run -> size;
+    else
+      memcpy (out, a, run -> size), out += run -> size, a += run -> size;
+
+  memcpy (out, a, ea - a);
+  out += ea - a;
+  memcpy (out, b, eb - b);
+
+  memcpy (run -> base, run -> tmp, (run -> n + run -> m) * run -> size);
+
+  return NULL;
+}
+
+
+/* Run [fn] on all the [n] runs, each one in its own thread */
+static void run_all (void * (* fn) (void *), run_t * runs, unsigned n)
+{
+  pthread_t tids [SORT_THREADS];
+  bool started [SORT_THREADS];
+  unsigned i;
+
+  for (i = 1; i < n; i ++)
+    started [i] = ! pthread_create (& tids [i], NULL, fn, & runs [i]);
+
+  /* The calling thread takes the first one (and those without a thread) */
+  fn (& runs [0]);
+  for (i = 1; i < n; i ++)
+    if (started [i])
+      pthread_join (tids [i], NULL);
+    else
+      fn (& runs [i]);
+}
+
+
+/* Sort [n] elements of [size] bytes in [base] using [cmp] (with [arg]) */
+void osh_sort (void * base, size_t n, size_t size, osh_cmp_t cmp, void * arg)
+{
+  run_t runs [SORT_THREADS];
+  size_t bounds [SORT_THREADS + 1];
+  long cpus    = sysconf (_SC_NPROCESSORS_ONLN);
+  unsigned k   = RMAX (1, RMIN (cpus, SORT_THREADS));
+  char * tmp;
+  unsigned i;
+
+  if (n < SORT_PARALLEL || k == 1 || ! (tmp = malloc (n * size)))
+    {
+      qsort_r (base, n, size, cmp, arg);
+      return;
+    }
+
+  /* Sort one chunk per thread */
+  for (i = 0; i <= k; i ++)
+    bounds [i] = n * i / k;
+
+  for (i = 0; i < k; i ++)
+    {
+      runs [i] . base = (char *) base + bounds [i] * size;
+      runs [i] . n    = bounds [i + 1] - bounds [i];
+      runs [i] . size = size;
+      runs [i] . cmp  = cmp;
+      runs [i] . arg  = arg;
+    }
+  run_all (sort_run, runs, k);
+
+  /* Merge adjacent runs two by two until only one is left */
+  while (k > 1)
+    {
+      unsigned pairs = k / 2;
+
+      for (i = 0; i < pairs; i ++)
+	{
+	  runs [i] . base = (char *) base + bounds [2 * i] * size;
+	  runs [i] . n    = bounds [2 * i + 1] - bounds [2 * i];
+	  runs [i] . m    = bounds [2 * i + 2] - bounds [2 * i + 1];
+	  runs [i] . tmp  = tmp + bounds [2 * i] * size;
+	}
+      run_all (merge_runs, runs, pairs);
+
+      /* Bounds of the merged runs (an odd one is left as it is) */
+      for (i = 0; i < pairs; i ++)
+	bounds [i] = bounds [2 * i];
+      if (k % 2)
+	bounds [i ++] = bounds [k - 1];
+      bounds [i] = n;
+      k = i;
+    }
+
+  free (tmp);
+}
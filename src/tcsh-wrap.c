@@ -92,6 +92,13 @@ void unset_variable (char * var)
 }
 
 
+/* Check if the [$name] variable is set */
+bool is_variable (char * name)
+{
+  return adrof (str2short (name)) != NULL;
+}
+
+
 /* Set the [$var] array */
 static void set_tables (char * var)
 {
@@ -160,9 +167,13 @@ static void tcsh_xxx (Char ** v, handler * func)
   while (* vv)
     argv = argsmore (argv, short2str (* vv ++));
 
-  /* It's time to execute the function */
+  /* It's time to execute the function (its output is buffered until it returns) */
+  osh_shell_enter ();                                           /* keep the health monitor away */
+  osh_output_begin ();
   if ((* func) (argslen (argv), argv))
     setcopy (STRstatus, Strsave (STR1), VAR_READWRITE);         /* set the $status variable */
+  osh_output_end ();
+  osh_shell_leave ();
 
   /* Set the [$osh_tables] variable for database names TAB-completion and globbing (only a subset of commands) */
   if (! strcmp (argv [0], "connect") || ! strcmp (argv [0], "tables") ||
@@ -0,0 +1,114 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* Project headers */
+#include "osh.h"
+
+
+/* The name of the variable that enables timing for all the DB builtins */
+#define TIMING_VARIABLE  "osh_timing"
+
+
+/* Labels for the spans (keep them in the same order of osh_span_t) */
+static char * labels [OSH_SPANS] =
+{
+  "prepare",
+  "execute",
+  "first-row",
+  "fetch-all",
+  "format",
+  "output"
+};
+
+
+/* Client-side timing of the command currently running (updated by worker threads too) */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static rtime_t spans [OSH_SPANS];
+static unsigned trips  = 0;
+static unsigned rows   = 0;
+static rtime_t started = 0;
+
+
+/* Reset all the counters at the beginning of a command */
+void osh_timing_reset (void)
+{
+  pthread_mutex_lock (& lock);
+  memset (spans, 0, sizeof (spans));
+  trips   = 0;
+  rows    = 0;
+  started = nswall ();
+  pthread_mutex_unlock (& lock);
+}
+
+
+/* Timing is enabled by option [--timing] or by the [$osh_timing] variable */
+bool osh_timing_enabled (bool option)
+{
+  return option || is_variable (TIMING_VARIABLE);
+}
+
+
+/* Add [elapsed] nsecs to [span] */
+void osh_timing_add (osh_span_t span, rtime_t elapsed)
+{
+  if (span < OSH_SPANS)
+    {
+      pthread_mutex_lock (& lock);
+      spans [span] += elapsed;
+      pthread_mutex_unlock (& lock);
+    }
+}
+
+
+/* Account for [n] more round trips to the server */
+void osh_timing_trips (unsigned n)
+{
+  pthread_mutex_lock (& lock);
+  trips += n;
+  pthread_mutex_unlock (& lock);
+}
+
+
+/* Account for one more row retrieved from the server in [elapsed] nsecs (the first one of the command has its own span) */
+void osh_timing_row (rtime_t elapsed)
+{
+  pthread_mutex_lock (& lock);
+  spans [rows ? OSH_SPAN_FETCH : OSH_SPAN_FIRSTROW] += elapsed;
+  rows ++;
+  pthread_mutex_unlock (& lock);
+}
+
+
+/* Print the breakdown of the time spent by the command currently running */
+void osh_timing_print (char * progname)
+{
+  rtime_t total;
+  rtime_t measured = 0;
+  unsigned n       = 0;
+  unsigned i;
+
+  /* The pager's worker may be still fetching */
+  pthread_mutex_lock (& lock);
+  total = nswall () - started;
+  for (i = 0; i < OSH_SPANS; i ++)
+    {
+      n = RMAX (n, strlen (labels [i]));
+      measured += spans [i];
+    }
+
+  printf ("%s: timing\n", progname);
+  for (i = 0; i < OSH_SPANS; i ++)
+    printf ("  %-*.*s : %s\n", n, n, labels [i], ns2a (spans [i]));
+  printf ("  %-*.*s : %s\n", n, n, "other", ns2a (total > measured ? total - measured : 0));
+  printf ("  %-*.*s : %s\n", n, n, "total", ns2a (total));
+  printf ("  %-*.*s : %u\n", n, n, "trips", trips);
+  printf ("  %-*.*s : %u\n", n, n, "rows",  rows);
+  pthread_mutex_unlock (& lock);
+}
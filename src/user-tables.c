@@ -40,7 +40,10 @@ enum
   OPT_UNSORT  = 'u',
   OPT_REVERSE = 'r',
 
-  OPT_RELOAD  = 'f'
+  OPT_RELOAD  = 'f',
+
+  /* Timing */
+  OPT_TIMING  = 'k'
 };
 
 
@@ -64,6 +67,9 @@ static struct option lopts [] =
 
   { "reload",  no_argument, NULL, OPT_RELOAD  },
 
+  /* Timing */
+  { "timing",  no_argument, NULL, OPT_TIMING  },
+
   { NULL,      0,           NULL, 0           }
 };
 
@@ -97,6 +103,7 @@ static void usage (char * progname, struct option * options)
   printf ("\n");
 
   usage_item (options, n, OPT_RELOAD,  "force reload of # of records");
+  usage_item (options, n, OPT_TIMING,  "show the client-side timing breakdown");
 }
 
 
@@ -157,6 +164,8 @@ static void print_user_tables_tree (char * argv [], bool reverse, osh_connection
 /* Print user tables in one of the supported output format */
 static void print_user_tables (unsigned format, char * argv [], unsigned width, bool reverse, osh_connection_t * conn, bool cols)
 {
+  rtime_t t1 = nswall ();
+
   switch (format)
     {
     case OPT_LIST:  args_print_rows (argv, width);                      break;
@@ -164,6 +173,8 @@ static void print_user_tables (unsigned format, char * argv [], unsigned width,
     case OPT_TABLE: print_user_tables_mx (argv, reverse, conn);         break;
     case OPT_TREE:  print_user_tables_tree (argv, reverse, conn, cols); break;
     }
+
+  osh_timing_add (OSH_SPAN_OUTPUT, nswall () - t1);
 }
 
 
@@ -180,6 +191,7 @@ int osh_tables (int argc, char * argv [])
   bool reverse    = false;
   bool reload     = false;
   bool cols       = false;
+  bool timing     = false;
 
   osh_connection_t * conn;
   int option;
@@ -217,6 +229,9 @@ int osh_tables (int argc, char * argv [])
         case OPT_REVERSE: reverse = true;          break;
 
         case OPT_RELOAD:  reload  = true;          break;
+
+	  /* Timing */
+        case OPT_TIMING:  timing  = true;          break;
 	}
     }
 
@@ -226,9 +241,14 @@ int osh_tables (int argc, char * argv [])
       if (len_connections ())
 	{
 	  /* Print user tables over current connection */
-	  conn = get_current_connection ();
+	  conn = get_active_connection ();
 
+	  osh_timing_reset ();
 	  print_user_tables (format, ocilib_user_table_names (conn, reload), width, reverse, conn, cols);
+
+	  /* Client-side timing breakdown */
+	  if (osh_timing_enabled (timing))
+	    osh_timing_print (progname);
 	}
       else
 	printf ("%s: no connection.\n", progname);
@@ -0,0 +1,269 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* Project headers */
+#include "osh.h"
+
+
+/*
+ * Watch mode.
+ *
+ * The same prepared statement is executed again every few seconds and
+ * the rows are compared with those of the previous run, matching them
+ * by the value of their first column (usually the key) or else by
+ * position, in order to show only what has changed.
+ */
+
+
+/* ANSI sequences to highlight changed cells on terminals */
+#define HIGHLIGHT_ON   "\033[7m"
+#define HIGHLIGHT_OFF  "\033[0m"
+
+
+static bool interrupted = false;
+
+
+/* What to do on ^C */
+static void on_ctrl_c (int signo)
+{
+  interrupted = true;
+}
+
+
+/* Are two values equal? (NULLs are equal to each other) */
+static bool same (char * a, char * b)
+{
+  return a == b || (a && b && ! strcmp (a, b));
+}
+
+
+/* Return a copy of the values of the first [n] rows (0 means all) of [rs] ([rows] x [cols] in row-major order) */
+char ** watch_snapshot (OCI_Resultset * rs, unsigned n, unsigned * rows)
+{
+  unsigned rssize = rs_size (rs);
+  unsigned cols   = OCI_GetColumnCount (rs);
+  char ** cells;
+  unsigned r;
+  unsigned c;
+
+  * rows = n ? RMIN (n, rssize) : rssize;
+  cells  = calloc ((size_t) * rows * cols + 1, sizeof (char *));
+
+  for (r = 0; r < * rows && ocilib_fetch (rs, r + 1); r ++)
+    for (c = 0; c < cols; c ++)
+      {
+	char * value = ocilib_value (rs, c + 1);
+	cells [r * cols + c] = value ? strdup (value) : NULL;
+      }
+  * rows = r;
+
+  return cells;
+}
+
+
+/* Release a snapshot */
+void watch_free (char ** cells, unsigned rows, unsigned cols)
+{
+  unsigned i;
+
+  if (cells)
+    for (i = 0; i < rows * cols; i ++)
+      safefree (cells [i]);
+  safefree (cells);
+}
+
+
+/*
+ * Mark in [marks] the cells of [now] that differ from [before] and
+ * return the # of rows changed (new rows are changed in all cells).
+ *
+ * Rows are matched by the value of their first column via a hash
+ * table of the previous run, or by position when it is NULL.
+ */
+unsigned watch_diff (char ** before, unsigned brows, char ** now, unsigned nrows, unsigned cols, bool * marks)
+{
+  unsigned size    = 1;
+  unsigned * index;
+  unsigned changed = 0;
+  unsigned r;
+  unsigned c;
+
+  if (! cols)
+    return 0;
+
+  /* Open addressing hash table of the previous rows by key (0 means empty, otherwise row + 1) */
+  while (size < 2 * brows + 1)
+    size *= 2;
+  index = calloc (size, sizeof (unsigned));
+  for (r = 0; r < brows; r ++)
+    if (before [r * cols])
+      {
+	unsigned h = osh_strhash (before [r * cols]) & (size - 1);
+	while (index [h])
+	  h = (h + 1) & (size - 1);
+	index [h] = r + 1;
+      }
+
+  for (r = 0; r < nrows; r ++)
+    {
+      char * key  = now [r * cols];
+      char ** old = NULL;
+      bool dirty  = false;
+
+      if (key)
+	{
+	  unsigned h = osh_strhash (key) & (size - 1);
+	  while (index [h] && ! same (before [(index [h] - 1) * cols], key))
+	    h = (h + 1) & (size - 1);
+	  if (index [h])
+	    old = before + (index [h] - 1) * cols;
+	}
+      else if (r < brows && ! before [r * cols])
+	old = before + r * cols;
+
+      for (c = 0; c < cols; c ++)
+	{
+	  marks [r * cols + c] = ! old || ! same (old [c], now [r * cols + c]);
+	  dirty |= marks [r * cols + c];
+	}
+      changed += dirty;
+    }
+
+  free (index);
+
+  return changed;
+}
+
+
+/* Format the rows in lines (column names first) and return the byte offsets of the columns in [offsets] */
+char ** watch_lines (OCI_Resultset * rs, char ** cells, unsigned rows, size_t ** offsets)
+{
+  unsigned cols  = OCI_GetColumnCount (rs) + 1;    /* +1 to include serial */
+  char ** table  = calloc ((size_t) (rows + 1) * cols, sizeof (char *));
+  char * serials = calloc (rows + 1, 16);
+  char ** argv;
+  unsigned r;
+  unsigned c;
+
+  for (c = 0; c < cols; c ++)
+    table [c] = ! c ? "#" : (char *) OCI_ColumnGetName (OCI_GetColumn (rs, c));
+
+  for (r = 0; r < rows; r ++)
+    {
+      snprintf (serials + r * 16, 16, "%u", r + 1);
+      table [(r + 1) * cols] = serials + r * 16;
+      for (c = 1; c < cols; c ++)
+	table [(r + 1) * cols + c] = cells [r * (cols - 1) + c - 1];
+    }
+
+  * offsets = calloc ((size_t) (rows + 1) * (cols + 1), sizeof (size_t));
+  argv = render_lines (table, NULL, rows + 1, cols, * offsets);
+
+  /* Memory cleanup */
+  free (serials);
+  free (table);
+
+  return argv;
+}
+
+
+/* Print [line] highlighting the cells marked in [marks] */
+static void print_marked (char * line, size_t * offsets, bool * marks, unsigned cols, bool tty)
+{
+  unsigned c;
+
+  for (c = 0; c < cols; c ++)
+    {
+      /* Serial and separator, then the cell (highlighted if changed) */
+      char * cell = line + offsets [c + 1] + 1;
+      size_t end  = c + 1 < cols ? offsets [c + 2] : offsets [cols + 1] - 1;
+      size_t len  = end - offsets [c + 1] - 1;
+
+      if (! c)
+	fwrite (line, 1, offsets [1] + 1, stdout);
+      if (tty && marks [c])
+	fputs (HIGHLIGHT_ON, stdout);
+      fwrite (cell, 1, len, stdout);
+      if (tty && marks [c])
+	fputs (HIGHLIGHT_OFF, stdout);
+      fputs ("|", stdout);
+    }
+  fputs ("\n", stdout);
+}
+
+
+/*
+ * Execute again the statement of [rs] every [seconds] until ^C and print
+ * the first [n] rows (0 means all): the whole table the first time, then
+ * only the rows that have changed, with the changed cells highlighted on
+ * terminals.
+ */
+void watch_table (OCI_Resultset * rs, unsigned n, unsigned seconds)
+{
+  void (* on_prev) (int) = signal (SIGINT, on_ctrl_c);
+  unsigned cols   = OCI_GetColumnCount (rs);
+  bool tty        = isatty (STDOUT_FILENO);
+  char ** before  = NULL;
+  unsigned brows  = 0;
+  unsigned run;
+
+  for (run = 1; rs && ! interrupted && ! osh_output_broken (); run ++)
+    {
+      unsigned rows;
+      char ** now   = watch_snapshot (rs, n, & rows);
+      bool * marks  = calloc ((size_t) rows * cols + 1, sizeof (bool));
+      unsigned changed = watch_diff (before, brows, now, rows, cols, marks);
+      time_t t      = time (NULL);
+      char when [32];
+
+      strftime (when, sizeof (when), "%H:%M:%S", localtime (& t));
+
+      if (run == 1 || changed || rows != brows)
+	{
+	  size_t * offsets;
+	  char ** lines = watch_lines (rs, now, rows, & offsets);
+	  unsigned r;
+
+	  printf ("%s: #%u records - #%u changed\n", when, rows, run == 1 ? 0 : changed);
+	  fputs (lines [0], stdout);
+	  fputs ("\n", stdout);
+	  for (r = 0; r < rows; r ++)
+	    if (run == 1)
+	      printf ("%s\n", lines [r + 1]);
+	    else if (memchr (marks + r * cols, true, cols))
+	      print_marked (lines [r + 1], offsets + (r + 1) * (cols + 2), marks + r * cols, cols, tty);
+
+	  /* Memory cleanup */
+	  argsclear (lines);
+	  free (offsets);
+	}
+      osh_output_flush ();
+
+      /* Keep this run to be compared with the next one */
+      watch_free (before, brows, cols);
+      before = now;
+      brows  = rows;
+      free (marks);
+
+      /* Wait (^C interrupts the sleep) and execute again the same statement */
+      if (! interrupted)
+	sleep (seconds);
+      if (! interrupted)
+	rs = ocilib_execute_again (rs);
+    }
+
+  /* Memory cleanup */
+  watch_free (before, brows, cols);
+
+  interrupted = false;
+
+  /* Re-enable ^C to its previous handler */
+  signal (SIGINT, on_prev);
+}
@@ -0,0 +1,284 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* System headers */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Project headers */
+#include "osh.h"
+
+
+/*
+ * Display width of UTF-8 strings (as stored in AL32UTF8 databases).
+ *
+ * ASCII runs take one column per byte and they are detected in bulk,
+ * so that only non-ASCII sequences are decoded and looked up in the
+ * tables of wide (2 columns) and combining (0 columns) characters.
+ * Locale settings are not required.
+ */
+
+
+typedef struct
+{
+  uint32_t first;
+  uint32_t last;
+} interval_t;
+
+
+/* East Asian Wide and Fullwidth characters */
+static const interval_t wide [] =
+{
+  { 0x01100, 0x0115f },  /* Hangul Jamo initial consonants */
+  { 0x02329, 0x0232a },  /* Angle brackets */
+  { 0x02e80, 0x0303e },  /* CJK Radicals .. CJK Symbols and Punctuation */
+  { 0x03041, 0x033ff },  /* Hiragana .. CJK Compatibility */
+  { 0x03400, 0x04dbf },  /* CJK Unified Ideographs Extension A */
+  { 0x04e00, 0x09fff },  /* CJK Unified Ideographs */
+  { 0x0a000, 0x0a4cf },  /* Yi */
+  { 0x0a960, 0x0a97f },  /* Hangul Jamo Extended-A */
+  { 0x0ac00, 0x0d7a3 },  /* Hangul Syllables */
+  { 0x0f900, 0x0faff },  /* CJK Compatibility Ideographs */
+  { 0x0fe10, 0x0fe19 },  /* Vertical forms */
+  { 0x0fe30, 0x0fe6f },  /* CJK Compatibility Forms .. Small Form Variants */
+  { 0x0ff00, 0x0ff60 },  /* Fullwidth Forms */
+  { 0x0ffe0, 0x0ffe6 },  /* Fullwidth Signs */
+  { 0x16fe0, 0x18aff },  /* Tangut */
+  { 0x1b000, 0x1b16f },  /* Kana Supplement .. Small Kana Extension */
+  { 0x1f300, 0x1f64f },  /* Miscellaneous Symbols and Pictographs .. Emoticons */
+  { 0x1f680, 0x1f6ff },  /* Transport and Map Symbols */
+  { 0x1f900, 0x1f9ff },  /* Supplemental Symbols and Pictographs */
+  { 0x20000, 0x2fffd },  /* CJK Unified Ideographs Extension B .. */
+  { 0x30000, 0x3fffd }   /* CJK Unified Ideographs Extension G .. */
+};
+
+
+/* Combining and zero width characters */
+static const interval_t zero [] =
+{
+  { 0x00300, 0x0036f },  /* Combining Diacritical Marks */
+  { 0x00483, 0x00489 },  /* Cyrillic combining marks */
+  { 0x00591, 0x005bd },  /* Hebrew points */
+  { 0x005bf, 0x005bf },
+  { 0x005c1, 0x005c2 },
+  { 0x005c4, 0x005c5 },
+  { 0x005c7, 0x005c7 },
+  { 0x00610, 0x0061a },  /* Arabic marks */
+  { 0x0064b, 0x0065f },
+  { 0x00670, 0x00670 },
+  { 0x006d6, 0x006dc },
+  { 0x006df, 0x006e4 },
+  { 0x006e7, 0x006e8 },
+  { 0x006ea, 0x006ed },
+  { 0x00900, 0x00902 },  /* Devanagari signs */
+  { 0x0093a, 0x0093a },
+  { 0x0093c, 0x0093c },
+  { 0x00941, 0x00948 },
+  { 0x0094d, 0x0094d },
+  { 0x00951, 0x00957 },
+  { 0x00e31, 0x00e31 },  /* Thai vowels and tone marks */
+  { 0x00e34, 0x00e3a },
+  { 0x00e47, 0x00e4e },
+  { 0x01160, 0x011ff },  /* Hangul Jamo medial vowels and final consonants */
+  { 0x01ab0, 0x01aff },  /* Combining Diacritical Marks Extended */
+  { 0x01dc0, 0x01dff },  /* Combining Diacritical Marks Supplement */
+  { 0x0200b, 0x0200f },  /* Zero width space, joiners and marks */
+  { 0x0202a, 0x0202e },  /* Bidirectional embeddings */
+  { 0x02060, 0x02064 },  /* Word joiner and invisible operators */
+  { 0x020d0, 0x020ff },  /* Combining Diacritical Marks for Symbols */
+  { 0x0302a, 0x0302d },  /* Ideographic tone marks */
+  { 0x03099, 0x0309a },  /* Kana voiced sound marks */
+  { 0x0fe00, 0x0fe0f },  /* Variation Selectors */
+  { 0x0fe20, 0x0fe2f },  /* Combining Half Marks */
+  { 0x0feff, 0x0feff },  /* Zero width no-break space */
+  { 0xe0001, 0xe007f },  /* Tags */
+  { 0xe0100, 0xe01ef }   /* Variation Selectors Supplement */
+};
+
+
+/* Binary search of [cp] in a sorted table of [n] intervals */
+static bool lookup (uint32_t cp, const interval_t * table, unsigned n)
+{
+  unsigned lo = 0;
+  unsigned hi = n;
+
+  if (cp < table [0] . first || cp > table [n - 1] . last)
+    return false;
+
+  while (lo < hi)
+    {
+      unsigned mid = (lo + hi) / 2;
+
+      if (cp > table [mid] . last)
+	lo = mid + 1;
+      else if (cp < table [mid] . first)
+	hi = mid;
+      else
+	return true;
+    }
+  return false;
+}
+
+
+/* Columns taken by the code point [cp] */
+static unsigned cp_width (uint32_t cp)
+{
+  if (lookup (cp, zero, sizeof (zero) / sizeof (zero [0])))
+    return 0;
+  if (lookup (cp, wide, sizeof (wide) / sizeof (wide [0])))
+    return 2;
+  return 1;
+}
+
+
+/* Return the offset of the first non-ASCII byte in [s] ([len] if none) */
+static size_t ascii_run (const unsigned char * s, size_t len)
+{
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  /* 32 bytes at a time: the sign bits of the bytes are set only for non-ASCII */
+  for (; i + 32 <= len; i += 32)
+    {
+      unsigned mask = _mm256_movemask_epi8 (_mm256_loadu_si256 ((const __m256i *) (s + i)));
+      if (mask)
+	return i + __builtin_ctz (mask);
+    }
+#endif
+
+#if defined(__SSE2__)
+  /* 16 bytes at a time */
+  for (; i + 16 <= len; i += 16)
+    {
+      unsigned mask = _mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *) (s + i)));
+      if (mask)
+	return i + __builtin_ctz (mask);
+    }
+#endif
+
+  /* Scalar tail (or fallback) */
+  for (; i < len; i ++)
+    if (s [i] & 0x80)
+      return i;
+
+  return len;
+}
+
+
+/* Decode the UTF-8 sequence at [s] in [cp] and return its length (invalid bytes are taken one by one) */
+static size_t utf8_decode (const unsigned char * s, size_t len, uint32_t * cp)
+{
+  size_t n;
+  size_t i;
+
+  if (s [0] >= 0xf0 && s [0] < 0xf8)
+    n = 4, * cp = s [0] & 0x07;
+  else if (s [0] >= 0xe0)
+    n = 3, * cp = s [0] & 0x0f;
+  else if (s [0] >= 0xc0)
+    n = 2, * cp = s [0] & 0x1f;
+  else
+    n = 0;
+
+  if (! n || n > len)
+    {
+      * cp = 0xfffd;
+      return 1;
+    }
+
+  for (i = 1; i < n; i ++)
+    {
+      if ((s [i] & 0xc0) != 0x80)
+	{
+	  * cp = 0xfffd;
+	  return 1;
+	}
+      * cp = (* cp << 6) | (s [i] & 0x3f);
+    }
+
+  return n;
+}
+
+
+/*
+ * Return the # of bytes of the longest prefix of [s] that fits in [max]
+ * columns, without splitting characters, and its width in [width].
+ */
+size_t osh_strclip (const char * s, size_t len, size_t max, size_t * width)
+{
+  const unsigned char * p = (const unsigned char *) s;
+  size_t cols = 0;
+  size_t i    = 0;
+
+  while (i < len)
+    {
+      /* ASCII fast path (one column per byte) */
+      size_t n = ascii_run (p + i, len - i);
+      uint32_t cp;
+      unsigned w;
+
+      if (cols + n >= max)
+	{
+	  i    += max - cols;
+	  cols  = max;
+	  break;
+	}
+      cols += n;
+      i    += n;
+      if (i == len)
+	break;
+
+      /* Decode a non-ASCII character */
+      n = utf8_decode (p + i, len - i, & cp);
+      w = cp_width (cp);
+      if (cols + w > max)
+	break;
+      cols += w;
+      i    += n;
+    }
+
+  /* Combining characters at the boundary belong to the previous one */
+  while (i < len && p [i] & 0x80)
+    {
+      uint32_t cp;
+      size_t n = utf8_decode (p + i, len - i, & cp);
+      if (cp_width (cp))
+	break;
+      i += n;
+    }
+
+  if (width)
+    * width = cols;
+  return i;
+}
+
+
+/* Return the # of columns needed to display the [len] bytes of [s] */
+size_t osh_strwidth (const char * s, size_t len)
+{
+  size_t width;
+
+  /* All-ASCII values (the common case) need just one scan */
+  if (ascii_run ((const unsigned char *) s, len) == len)
+    return len;
+
+  osh_strclip (s, len, len * 2, & width);
+  return width;
+}
+
+
+/* Return the # of columns needed to display the null terminated string [s] */
+size_t osh_width (const char * s)
+{
+  return s ? osh_strwidth (s, strlen (s)) : 0;
+}
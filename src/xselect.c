@@ -0,0 +1,1162 @@
+/*
+ * osh - A shell for Oracle
+ *
+ * R. Carbone (rocco@tecsiel.it)
+ * 2Q 2019
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ */
+
+
+/* System headers */
+#include <math.h>
+#include <ctype.h>
+#include <strings.h>
+
+/* Project headers */
+#include "osh.h"
+#include "ocilib.h"
+
+
+/* Identifiers */
+#define NAME         "xselect"
+#define BRIEF        "Select records across many connections"
+#define SYNOPSIS     "xselect [options] -- select col[,col ...] from table [where <condition>] [order by <columns>]"
+#define DESCRIPTION  "Execute the same query on many connections concurrently and merge the ordered results in one"
+
+/* Public variable */
+osh_command_t cmd_xselect = { NAME, BRIEF, SYNOPSIS, DESCRIPTION, osh_xselect };
+
+
+/*
+ * Cross-connection select.
+ *
+ * The query runs on every matching connection at the same time, each
+ * one in its own thread that fetches and decodes the rows ahead into
+ * a bounded queue.  The shell merges the heads of the queues with a
+ * binary heap ordered as the ORDER BY clause of the query (k-way merge),
+ * so each connection is read in its own order and no resort is needed.
+ * The merged rows are rendered as soon as they are taken from the heap,
+ * so the memory in use does not depend on the size of the result.
+ *
+ * COUNT, SUM, MIN and MAX columns can also be combined across the
+ * connections, grouping by the other columns.  Only then, and for the
+ * curses viewer, all the merged rows are kept in memory.
+ */
+
+
+/* # of rows decoded ahead by each connection while merging */
+#define SHARD_QUEUE  1024
+
+/* # of merged rows to size the table columns on */
+#define TABLE_SAMPLE  1024
+
+
+/* A decoded row */
+typedef struct
+{
+  char ** values;           /* NULL for NULLs                               */
+  double * keys;            /* typed keys of numbers and dates              */
+
+} item_t;
+
+
+/* A connection the query runs on */
+typedef struct
+{
+  osh_connection_t * conn;
+  pthread_t tid;
+  bool started;
+
+  /* Columns of the ResultSet */
+  unsigned cols;
+  char ** names;
+  unsigned * types;
+  bool described;
+
+  /* The rows fetched and not yet merged */
+  item_t queue [SHARD_QUEUE];
+  unsigned head;
+  unsigned count;
+  bool eof;
+  char * error;
+
+  struct merge * merge;
+
+} shard_t;
+
+
+/* The connections being merged */
+typedef struct merge
+{
+  pthread_mutex_t lock;
+  pthread_cond_t produced;  /* a shard has rows (or it is done)             */
+  pthread_cond_t consumed;  /* a shard has room for other rows              */
+  bool quit;                /* stop fetching                                */
+  char * query;
+
+} merge_t;
+
+
+/* A column of the ORDER BY clause */
+typedef struct
+{
+  unsigned column;          /* zero-based                                   */
+  bool descending;
+  bool nullsfirst;
+
+} order_t;
+
+
+/* How to combine a column across connections */
+typedef enum
+{
+  AGG_KEY,
+  AGG_COUNT,
+  AGG_SUM,
+  AGG_MIN,
+  AGG_MAX
+
+} agg_t;
+
+
+static bool interrupted = false;
+
+
+/* What to do on ^C */
+static void on_ctrl_c (int signo)
+{
+  interrupted = true;
+}
+
+
+/* GNU short options */
+enum
+{
+  /* Startup */
+  OPT_HELP      = 'h',
+  OPT_QUIET     = 'q',
+
+  /* Connections */
+  OPT_ON        = 'o',
+
+  /* ResultSet size */
+  OPT_RSSIZE    = 'n',
+
+  /* Aggregation */
+  OPT_AGGREGATE = 'a',
+
+  /* Timing */
+  OPT_TIMING    = 'k',
+
+  /* Output formats */
+  OPT_TABLE     = 'm',
+  OPT_VERTICAL  = 'v',
+  OPT_JSON      = 'j',
+  OPT_JSONL     = 'J',
+  OPT_CURSES    = 'c',
+  OPT_FORMAT    = 'f'
+};
+
+
+/* GNU long options */
+static struct option lopts [] =
+{
+  /* Startup */
+  { "help",      no_argument,       NULL, OPT_HELP      },
+  { "quiet",     no_argument,       NULL, OPT_QUIET     },
+
+  /* Connections */
+  { "on",        required_argument, NULL, OPT_ON        },
+
+  /* ResultSet size */
+  { "size",      required_argument, NULL, OPT_RSSIZE    },
+
+  /* Aggregation */
+  { "aggregate", no_argument,       NULL, OPT_AGGREGATE },
+
+  /* Timing */
+  { "timing",    no_argument,       NULL, OPT_TIMING    },
+
+  /* Output formats */
+  { "table",     no_argument,       NULL, OPT_TABLE     },
+  { "vertical",  no_argument,       NULL, OPT_VERTICAL  },
+  { "json",      no_argument,       NULL, OPT_JSON      },
+  { "jsonl",     no_argument,       NULL, OPT_JSONL     },
+  { "curses",    no_argument,       NULL, OPT_CURSES    },
+  { "format",    required_argument, NULL, OPT_FORMAT    },
+
+  { NULL,        0,                 NULL, 0             }
+};
+
+
+/* Display the syntax */
+static void usage (char * progname, struct option * options)
+{
+  /* longest option name */
+  unsigned n = optmax (options);
+
+  printf ("%s, %s\n", progname, NAME);
+  printf ("Usage: %s [options] -- select ... [order by <columns>]\n", progname);
+  printf ("\n");
+
+  printf ("Startup:\n");
+  usage_item (options, n, OPT_HELP,      "show this help message and exit");
+  usage_item (options, n, OPT_QUIET,     "run quietly");
+  printf ("\n");
+
+  printf ("Connections:\n");
+  usage_item (options, n, OPT_ON,        "only the connections whose tag or TNS name matches a shell pattern");
+  printf ("\n");
+
+  /* ResultSet size */
+  usage_item (options, n, OPT_RSSIZE,    "# of records to display (0 means all)");
+  printf ("\n");
+
+  /* Aggregation */
+  usage_item (options, n, OPT_AGGREGATE, "combine the COUNT, SUM, MIN and MAX columns (eg. SUM(X) or SUM_X) grouping by the others");
+  printf ("\n");
+
+  /* Timing */
+  usage_item (options, n, OPT_TIMING,    "show the client-side timing breakdown");
+  printf ("\n");
+
+  /* Output formats */
+  usage_item (options, n, OPT_TABLE,     "display in a formatted table");
+  usage_item (options, n, OPT_VERTICAL,  "display one block per record");
+  usage_item (options, n, OPT_JSON,      "display in a JSON array of objects");
+  usage_item (options, n, OPT_JSONL,     "display in JSON Lines, one object per record");
+  usage_item (options, n, OPT_CURSES,    "display in a window");
+  usage_item (options, n, OPT_FORMAT,    "display in the given format (table, vertical, json, jsonl, curses)");
+}
+
+
+/* Map the name of an output format to its option */
+static int format_by_name (char * name)
+{
+  struct option * o;
+
+  for (o = lopts; o -> name; o ++)
+    if (! strcmp (o -> name, name))
+      switch (o -> val)
+	{
+	case OPT_TABLE:
+	case OPT_VERTICAL:
+	case OPT_JSON:
+	case OPT_JSONL:
+	case OPT_CURSES:
+	  return o -> val;
+	}
+  return 0;
+}
+
+
+/* How the rows are rendered in the output format [fmt] (except curses) */
+static osh_render_t render_format (int fmt)
+{
+  switch (fmt)
+    {
+    case OPT_VERTICAL: return OSH_RENDER_VERTICAL;
+    case OPT_JSON:     return OSH_RENDER_JSON;
+    case OPT_JSONL:    return OSH_RENDER_JSONL;
+    default:           return OSH_RENDER_TABLE;
+    }
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* Release a decoded row */
+static void item_free (item_t * item, unsigned cols)
+{
+  unsigned c;
+
+  if (item -> values)
+    for (c = 0; c < cols; c ++)
+      safefree (item -> values [c]);
+  safefree (item -> values);
+  safefree (item -> keys);
+}
+
+
+/* A worker thread: execute the query on a connection and decode its rows in the queue */
+static void * fetch_shard (void * arg)
+{
+  shard_t * shard = arg;
+  merge_t * merge = shard -> merge;
+  osh_connection_t * conn = shard -> conn;
+  osh_connection_t * session;
+  OCI_Resultset * rs = NULL;
+  unsigned c;
+
+  /* A session of the pool if any */
+  if ((session = ocilib_borrow (conn)))
+    rs = ocilib_resultset (session, merge -> query);
+  if (! rs)
+    ocilib_giveback (conn, session);
+
+  pthread_mutex_lock (& merge -> lock);
+  if (! rs)
+    {
+      shard -> error = safedup (conn -> logon ? "cannot connect" : osh_connection_error (conn));
+      shard -> eof   = true;
+      pthread_cond_broadcast (& merge -> produced);
+      pthread_mutex_unlock (& merge -> lock);
+      return NULL;
+    }
+
+  /* Columns first (they must be the same on all the connections) */
+  shard -> cols  = OCI_GetColumnCount (rs);
+  shard -> names = calloc (shard -> cols + 1, sizeof (char *));
+  shard -> types = calloc (shard -> cols + 1, sizeof (unsigned));
+  for (c = 0; c < shard -> cols; c ++)
+    {
+      OCI_Column * col = OCI_GetColumn (rs, c + 1);
+      shard -> names [c] = strdup ((char *) OCI_ColumnGetName (col));
+      shard -> types [c] = OCI_ColumnGetType (col);
+    }
+  shard -> described = true;
+  pthread_cond_broadcast (& merge -> produced);
+  pthread_mutex_unlock (& merge -> lock);
+
+  /* Then the rows, waiting while the queue is full */
+  while (ocilib_next (rs))
+    {
+      item_t item;
+
+      item . values = calloc (shard -> cols + 1, sizeof (char *));
+      item . keys   = calloc (shard -> cols + 1, sizeof (double));
+      for (c = 0; c < shard -> cols; c ++)
+	{
+	  char * value = ocilib_value (rs, c + 1);
+	  item . values [c] = value ? strdup (value) : NULL;
+	  item . keys [c]   = ocilib_key (rs, c + 1, shard -> types [c]);
+	}
+
+      pthread_mutex_lock (& merge -> lock);
+      while (shard -> count == SHARD_QUEUE && ! merge -> quit)
+	pthread_cond_wait (& merge -> consumed, & merge -> lock);
+      if (merge -> quit)
+	{
+	  pthread_mutex_unlock (& merge -> lock);
+	  item_free (& item, shard -> cols);
+	  break;
+	}
+      shard -> queue [(shard -> head + shard -> count ++) % SHARD_QUEUE] = item;
+      pthread_cond_broadcast (& merge -> produced);
+      pthread_mutex_unlock (& merge -> lock);
+    }
+
+  /* Free the statement and all resources associated to it */
+  OCI_StatementFree (OCI_ResultsetGetStatement (rs));
+  ocilib_giveback (conn, session);
+  conn -> used = nswall ();
+
+  pthread_mutex_lock (& merge -> lock);
+  shard -> eof = true;
+  pthread_cond_broadcast (& merge -> produced);
+  pthread_mutex_unlock (& merge -> lock);
+
+  return NULL;
+}
+
+
+/* Wait for a row in the queue of [shard] (called holding the lock); return false once it is drained */
+static bool wait_head (merge_t * merge, shard_t * shard)
+{
+  while (! shard -> count && ! shard -> eof)
+    pthread_cond_wait (& merge -> produced, & merge -> lock);
+
+  return shard -> count > 0;
+}
+
+
+/* Take the row at the head of the queue of [shard] (called holding the lock) */
+static item_t take_head (merge_t * merge, shard_t * shard)
+{
+  item_t item = shard -> queue [shard -> head];
+
+  shard -> head = (shard -> head + 1) % SHARD_QUEUE;
+  shard -> count --;
+  pthread_cond_broadcast (& merge -> consumed);
+
+  return item;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/*
+ * Compare the values of a column in two rows (numbers and dates by their
+ * typed keys, NULLs equal to each other).  Numbers of more than 15 digits
+ * can have the same typed key, so their exact text decides the ties.
+ */
+static int cmp_column (item_t * a, item_t * b, unsigned c, unsigned type)
+{
+  int cmp;
+
+  if (! a -> values [c] || ! b -> values [c])
+    return ! a -> values [c] && ! b -> values [c] ? 0 : ! a -> values [c] ? 1 : -1;
+
+  switch (type)
+    {
+    case OCI_CDT_NUMERIC:
+      if (! isnan (a -> keys [c]) && ! isnan (b -> keys [c]) && a -> keys [c] != b -> keys [c])
+	return a -> keys [c] < b -> keys [c] ? -1 : 1;
+      if (osh_decimal_cmp (a -> values [c], b -> values [c], & cmp))
+	return cmp;
+      if (! isnan (a -> keys [c]) && ! isnan (b -> keys [c]))
+	return 0;
+      return strcmp (a -> values [c], b -> values [c]);
+
+    case OCI_CDT_DATETIME:
+      if (! isnan (a -> keys [c]) && ! isnan (b -> keys [c]))
+	return a -> keys [c] < b -> keys [c] ? -1 : a -> keys [c] > b -> keys [c];
+      /* fall through */
+
+    default:
+      return strcmp (a -> values [c], b -> values [c]);
+    }
+}
+
+
+/* Compare two rows as the ORDER BY clause [by] of [n] columns would do */
+static int cmp_items (item_t * a, item_t * b, order_t * by, unsigned n, unsigned * types)
+{
+  unsigned i;
+
+  for (i = 0; i < n; i ++)
+    {
+      unsigned c = by [i] . column;
+      int cmp;
+
+      /* NULLs are placed on their own (last in ascending order by default, as the server does) */
+      if (! a -> values [c] != ! b -> values [c])
+	return (! a -> values [c] ? 1 : -1) * (by [i] . nullsfirst ? -1 : 1);
+
+      cmp = cmp_column (a, b, c, types [c]);
+      if (cmp)
+	return by [i] . descending ? - cmp : cmp;
+    }
+
+  return 0;
+}
+
+
+/* The heap of the shards by their head rows (ties in order of connection, to keep the merge stable) */
+typedef struct
+{
+  shard_t * shards;
+  unsigned * index;
+  unsigned n;
+  order_t * by;
+  unsigned nby;
+  unsigned * types;
+
+} heap_t;
+
+
+static bool heap_less (heap_t * heap, unsigned i, unsigned j)
+{
+  shard_t * a = & heap -> shards [heap -> index [i]];
+  shard_t * b = & heap -> shards [heap -> index [j]];
+  int cmp     = cmp_items (& a -> queue [a -> head], & b -> queue [b -> head], heap -> by, heap -> nby, heap -> types);
+
+  return cmp ? cmp < 0 : heap -> index [i] < heap -> index [j];
+}
+
+
+/* Move down the shard at [i] to its place in the heap */
+static void heap_down (heap_t * heap, unsigned i)
+{
+  for (;;)
+    {
+      unsigned l     = 2 * i + 1;
+      unsigned r     = l + 1;
+      unsigned least = i;
+      unsigned tmp;
+
+      if (l < heap -> n && heap_less (heap, l, least))
+	least = l;
+      if (r < heap -> n && heap_less (heap, r, least))
+	least = r;
+      if (least == i)
+	break;
+
+      tmp = heap -> index [i];
+      heap -> index [i] = heap -> index [least];
+      heap -> index [least] = tmp;
+      i = least;
+    }
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* Skip blanks */
+static char * skip_blanks (char * s)
+{
+  while (* s && strchr (" \t\r\n", * s))
+    s ++;
+  return s;
+}
+
+
+/* Is the word [w] at [s] (case insensitive, not followed by other letters)? */
+static bool word_at (char * s, char * w)
+{
+  size_t len = strlen (w);
+  char next  = s [len];
+
+  return ! strncasecmp (s, w, len) && ! (isalnum ((unsigned char) next) || next == '_' || next == '$' || next == '#');
+}
+
+
+/* Where the ORDER BY clause of [query] starts (NULL if none), that is outside quotes and parentheses */
+static char * order_by (char * query)
+{
+  char * found = NULL;
+  unsigned depth = 0;
+  char quote = 0;
+  char * s;
+
+  for (s = query; * s; s ++)
+    if (quote)
+      quote = * s == quote ? 0 : quote;
+    else if (* s == '\'' || * s == '"')
+      quote = * s;
+    else if (* s == '(')
+      depth ++;
+    else if (* s == ')')
+      depth -= depth > 0;
+    else if (! depth && (s == query || strchr (" \t\r\n)", s [-1])) && word_at (s, "order") && word_at (skip_blanks (s + 5), "by"))
+      found = skip_blanks (s + 5) + 2;
+
+  return found;
+}
+
+
+/*
+ * Map the items of the ORDER BY clause of [query] to the [cols] columns
+ * [names] (by position, by name or by alias) and return their # (0 if
+ * the query is not ordered, -1 if an item is not in the select list).
+ */
+static int parse_order (char * query, char ** names, unsigned cols, order_t ** by, char ** bad)
+{
+  char * clause = order_by (query);
+  char * items;
+  char * item;
+  char * next;
+  int n = 0;
+
+  * by = NULL;
+  if (! clause)
+    return 0;
+
+  items = strdup (clause);
+  * by  = calloc (cols + 1, sizeof (order_t));
+
+  for (item = items; item && * (item = skip_blanks (item)); item = next)
+    {
+      char * end;
+      char * name;
+      unsigned c;
+      int depth = 0;
+
+      /* The row limiting clause (if any) ends the list */
+      if (word_at (item, "offset") || word_at (item, "fetch"))
+	break;
+
+      /* Split the items at commas outside parentheses */
+      for (end = item; * end && (depth > 0 || * end != ','); end ++)
+	depth += * end == '(' ? 1 : * end == ')' ? -1 : 0;
+      next = * end ? end + 1 : NULL;
+      * end = 0x00;
+
+      /* The expression up to the first blank (eg. "t.id desc nulls first") */
+      for (end = item; * end && ! strchr (" \t\r\n", * end); end ++)
+	;
+      name = item;
+      item = skip_blanks (end);
+      * end = 0x00;
+
+      if (n == (int) cols)
+	break;
+
+      (* by) [n] . descending = word_at (item, "desc");
+      (* by) [n] . nullsfirst = (* by) [n] . descending;
+      if (word_at (item, "asc") || word_at (item, "desc"))
+	item = skip_blanks (item + ((* by) [n] . descending ? 4 : 3));
+      if (word_at (item, "nulls"))
+	(* by) [n] . nullsfirst = word_at (skip_blanks (item + 5), "first");
+
+      /* By position, or by name (the table prefix and the quotes are not part of it) */
+      if (* name && strspn (name, "0123456789") == strlen (name))
+	c = atoi (name) - 1;
+      else
+	{
+	  char * dot = strrchr (name, '.');
+	  bool quoted;
+
+	  if (dot)
+	    name = dot + 1;
+	  quoted = * name == '"';
+	  if (quoted)
+	    {
+	      name ++;
+	      if (* name && name [strlen (name) - 1] == '"')
+		name [strlen (name) - 1] = 0x00;
+	    }
+	  for (c = 0; c < cols; c ++)
+	    if (quoted ? ! strcmp (names [c], name) : ! strcasecmp (names [c], name))
+	      break;
+	}
+
+      if (c >= cols)
+	{
+	  * bad = strdup (name);
+	  free (items);
+	  safefree (* by);
+	  return -1;
+	}
+      (* by) [n ++] . column = c;
+    }
+
+  free (items);
+
+  return n;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* How to combine the column [name] (-1 for AVG, which cannot be combined) */
+static int agg_kind (char * name)
+{
+  static struct { char * prefix; int kind; } aggs [] =
+  {
+    { "COUNT", AGG_COUNT },
+    { "SUM",   AGG_SUM   },
+    { "MIN",   AGG_MIN   },
+    { "MAX",   AGG_MAX   },
+    { "AVG",   -1        },
+    { NULL,    AGG_KEY   }
+  };
+  unsigned i;
+
+  for (i = 0; aggs [i] . prefix; i ++)
+    {
+      size_t len = strlen (aggs [i] . prefix);
+      if (! strncasecmp (name, aggs [i] . prefix, len) && (name [len] == '(' || name [len] == '_'))
+	return aggs [i] . kind;
+    }
+
+  return AGG_KEY;
+}
+
+
+/*
+ * FNV-1a hash of the group keys of a row.  The keys are compared by their
+ * text, which is exact also for numbers and dates (ocilib_value() keeps
+ * all the digits of a number), while the typed keys of big numbers are
+ * doubles and could make different groups the same.
+ */
+static unsigned group_hash (item_t * item, int * kinds, unsigned cols)
+{
+  unsigned h = OSH_HASH_INIT;
+  unsigned c;
+
+  for (c = 0; c < cols; c ++)
+    if (kinds [c] == AGG_KEY)
+      {
+	char * v = item -> values [c];
+	h = osh_hash (v ? "\1" : "\0", 1, h);
+	if (v)
+	  h = osh_hash (v, strlen (v), h);
+      }
+
+  return h;
+}
+
+
+/* Are the group keys of two rows the same? */
+static bool same_group (item_t * a, item_t * b, int * kinds, unsigned cols)
+{
+  unsigned c;
+
+  for (c = 0; c < cols; c ++)
+    if (kinds [c] == AGG_KEY)
+      if (! a -> values [c] != ! b -> values [c] || (a -> values [c] && strcmp (a -> values [c], b -> values [c])))
+	return false;
+
+  return true;
+}
+
+
+/* Combine the columns of [item] into [group] (the sums are exact on the text, the typed keys are only for the order) */
+static void combine (item_t * group, item_t * item, int * kinds, unsigned * types, unsigned cols)
+{
+  unsigned c;
+
+  for (c = 0; c < cols; c ++)
+    {
+      char number [64];
+      char * sum;
+
+      switch (kinds [c])
+	{
+	case AGG_COUNT:
+	case AGG_SUM:
+	  if (! item -> values [c])
+	    break;
+	  if (! group -> values [c])
+	    {
+	      group -> values [c] = strdup (item -> values [c]);
+	      group -> keys [c]   = item -> keys [c];
+	      break;
+	    }
+	  group -> keys [c] += item -> keys [c];
+	  if (! (sum = osh_decimal_add (group -> values [c], item -> values [c])))
+	    {
+	      /* Not a plain decimal number (eg. a BINARY_DOUBLE with an exponent) */
+	      snprintf (number, sizeof (number), "%.15g", group -> keys [c]);
+	      sum = strdup (number);
+	    }
+	  free (group -> values [c]);
+	  group -> values [c] = sum;
+	  break;
+
+	case AGG_MIN:
+	case AGG_MAX:
+	  if (! item -> values [c])
+	    break;
+	  if (! group -> values [c] || (kinds [c] == AGG_MIN ? -1 : 1) * cmp_column (item, group, c, types [c]) > 0)
+	    {
+	      safefree (group -> values [c]);
+	      group -> values [c] = strdup (item -> values [c]);
+	      group -> keys [c]   = item -> keys [c];
+	    }
+	  break;
+	}
+    }
+}
+
+
+/* Combine the rows in [items] with the same group keys (in order of first appearance) */
+static unsigned aggregate (item_t * items, unsigned n, int * kinds, unsigned * types, unsigned cols)
+{
+  unsigned size   = 1;
+  unsigned * index;
+  unsigned groups = 0;
+  unsigned r;
+
+  while (size < 2 * n + 1)
+    size *= 2;
+  index = calloc (size, sizeof (unsigned));       /* 0 means empty, otherwise group + 1 */
+
+  for (r = 0; r < n; r ++)
+    {
+      unsigned h = group_hash (& items [r], kinds, cols) & (size - 1);
+
+      while (index [h] && ! same_group (& items [index [h] - 1], & items [r], kinds, cols))
+	h = (h + 1) & (size - 1);
+
+      if (! index [h])
+	{
+	  /* A new group starts from its first row (the groups are kept first, the rows combined after them) */
+	  item_t row = items [r];
+
+	  items [r] = items [groups];
+	  items [groups] = row;
+	  index [h] = ++ groups;
+	}
+      else
+	combine (& items [index [h] - 1], & items [r], kinds, types, cols);
+    }
+
+  /* Release the rows combined into the groups */
+  for (r = groups; r < n; r ++)
+    item_free (& items [r], cols);
+
+  free (index);
+
+  return groups;
+}
+
+
+/* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- */
+
+
+/* The [xselect] command */
+int osh_xselect (int argc, char * argv [])
+{
+  char * progname = basename (argv [0]);
+  char * sopts    = optlegitimate (lopts);
+
+  /* Variables that are set according to the specified options */
+  bool quiet      = false;
+  char * on       = NULL;
+  unsigned wsize  = 0;             /* how many records to display */
+  bool combined   = false;
+  unsigned fmt    = OPT_TABLE;
+  bool timing     = false;
+
+  merge_t merge;
+  shard_t * shards;
+  unsigned n      = 0;
+  shard_t * model = NULL;          /* the first connection with columns */
+  unsigned failed = 0;
+  order_t * by    = NULL;
+  int nby         = 0;
+  char * bad      = NULL;
+  int * kinds     = NULL;
+  heap_t heap;
+  bool streaming  = false;         /* render the rows as they are merged */
+  osh_stream_t * stream = NULL;
+  item_t * items  = NULL;
+  unsigned nitems = 0;
+  osh_rows_t * rows;
+  char source [64];
+  unsigned i;
+  unsigned c;
+  rtime_t t1;
+
+  /* signal handler */
+  void (* on_prev) (int);
+
+  int option;
+
+  /* Lookup for the command in the static table of registered extensions */
+  if (! cmd_by_name (progname))
+    {
+      printf ("%s: Command [%s] not found.\n", progname, progname);
+      return 1;
+    }
+
+  /* Parse command line options */
+  optind = 0;
+  optarg = NULL;
+  argv [0] = progname;
+  while ((option = getopt_long (argc, argv, sopts, lopts, NULL)) != -1)
+    {
+      switch (option)
+	{
+	default: if (! quiet) printf ("Try '%s --help' for more information.\n", progname); return 1;
+
+	  /* Startup */
+	case OPT_HELP:      usage (progname, lopts); return 0;
+	case OPT_QUIET:     quiet = true;            break;
+
+	  /* Connections */
+	case OPT_ON:        on = optarg;             break;
+
+	  /* ResultSet size */
+	case OPT_RSSIZE:    wsize = atoi (optarg);   break;
+
+	  /* Aggregation */
+	case OPT_AGGREGATE: combined = true;         break;
+
+	  /* Timing */
+	case OPT_TIMING:    timing = true;           break;
+
+	  /* Output formats */
+	case OPT_TABLE:     fmt = option;            break;
+	case OPT_VERTICAL:  fmt = option;            break;
+	case OPT_JSON:      fmt = option;            break;
+	case OPT_JSONL:     fmt = option;            break;
+	case OPT_CURSES:    fmt = option;            break;
+
+	case OPT_FORMAT:
+	  if (! (fmt = format_by_name (optarg)))
+	    {
+	      if (! quiet)
+		printf ("%s: Unknown output format [%s].\n", progname, optarg);
+	      return 1;
+	    }
+	  break;
+	}
+    }
+
+  /* Check for mandatory arguments */
+  if (optind == argc)
+    {
+      if (! quiet)
+	printf ("%s: missing query\n", progname);
+      return 1;
+    }
+
+  /* Keep machine readable formats clean of progress messages */
+  if (fmt == OPT_JSON || fmt == OPT_JSONL)
+    quiet = true;
+
+  /* Check # of connections */
+  if (! len_connections ())
+    {
+      if (! quiet)
+	printf ("%s: no connection.\n", progname);
+      return 0;
+    }
+
+  /* The matching connections in the order of the table */
+  shards = calloc (len_connections () + 1, sizeof (shard_t));
+  for (i = 0; i < len_connections (); i ++)
+    if (osh_connection_matches (get_connections () [i], on))
+      shards [n ++] . conn = get_connections () [i];
+
+  if (! n)
+    {
+      if (! quiet)
+	printf ("%s: no connection matching [%s]\n", progname, on);
+      free (shards);
+      return 1;
+    }
+
+  /* Build the query from remaining non-option arguments ("select" may be omitted) */
+  memset (& merge, 0, sizeof (merge));
+  if (strcasecmp (argv [optind], "select"))
+    argv [-- optind] = "select";
+  merge . query = argsjoin (argv + optind);
+
+  pthread_mutex_init (& merge . lock, NULL);
+  pthread_cond_init (& merge . produced, NULL);
+  pthread_cond_init (& merge . consumed, NULL);
+
+  if (! quiet)
+    osh_progress ("%s: querying #%u connections for [%s] ... ", progname, n, merge . query);
+
+  /* Enable ^C */
+  on_prev = signal (SIGINT, on_ctrl_c);
+
+  /* Run the query everywhere at the same time */
+  osh_timing_reset ();
+  t1 = nswall ();
+  for (i = 0; i < n; i ++)
+    {
+      shards [i] . merge   = & merge;
+      shards [i] . started = ! pthread_create (& shards [i] . tid, NULL, fetch_shard, & shards [i]);
+      if (! shards [i] . started)
+	{
+	  shards [i] . error = strdup ("cannot start a thread");
+	  shards [i] . eof   = true;
+	}
+    }
+
+  /* Wait for the columns (or the errors) of all the connections */
+  pthread_mutex_lock (& merge . lock);
+  for (i = 0; i < n; i ++)
+    {
+      while (! shards [i] . described && ! shards [i] . eof)
+	pthread_cond_wait (& merge . produced, & merge . lock);
+
+      if (shards [i] . error)
+	failed ++;
+      else if (! model)
+	model = & shards [i];
+      else if (shards [i] . cols != model -> cols)
+	{
+	  shards [i] . error = strdup ("different columns");
+	  failed ++;
+	}
+    }
+  pthread_mutex_unlock (& merge . lock);
+
+  /* How to merge and combine the rows */
+  if (! failed && (nby = parse_order (merge . query, model -> names, model -> cols, & by, & bad)) < 0)
+    {
+      if (! quiet)
+	printf ("failed - [ORDER BY %s is not a column of the select list]\n", bad);
+      failed = n;
+    }
+
+  if (! failed && combined)
+    {
+      kinds = calloc (model -> cols + 1, sizeof (int));
+      for (c = 0; c < model -> cols; c ++)
+	if ((kinds [c] = agg_kind (model -> names [c])) < 0)
+	  {
+	    if (! quiet)
+	      printf ("failed - [%s cannot be combined, select SUM and COUNT instead]\n", model -> names [c]);
+	    failed = n;
+	    break;
+	  }
+    }
+
+  /* Unless they have to be combined or browsed, the rows are rendered as they are merged */
+  streaming = ! failed && ! combined && fmt != OPT_CURSES;
+  if (streaming)
+    {
+      if (! quiet)
+	printf ("Ok! #%u connections answered in %s\n", n, ns2a (nswall () - t1));
+      stream = render_stream_begin (render_format (fmt), model -> cols, model -> names, model -> types, TABLE_SAMPLE);
+    }
+
+  /* Merge all the queues (k-way) as long as the rows come in */
+  if (! failed)
+    {
+      heap . shards = shards;
+      heap . index  = calloc (n + 1, sizeof (unsigned));
+      heap . n      = 0;
+      heap . by     = by;
+      heap . nby    = nby;
+      heap . types  = model -> types;
+
+      pthread_mutex_lock (& merge . lock);
+      for (i = 0; i < n; i ++)
+	if (wait_head (& merge, & shards [i]))
+	  heap . index [heap . n ++] = i;
+      for (i = heap . n / 2; i-- > 0; )
+	heap_down (& heap, i);
+
+      while (heap . n && ! interrupted && (combined || ! wsize || nitems < wsize))
+	{
+	  shard_t * shard = & shards [heap . index [0]];
+	  item_t item     = take_head (& merge, shard);
+	  bool more       = true;
+
+	  /* The next row of the same connection, if any, goes in its place */
+	  if (! wait_head (& merge, shard))
+	    heap . index [0] = heap . index [-- heap . n];
+	  heap_down (& heap, 0);
+
+	  if (streaming)
+	    {
+	      /* Render the row without holding up the connections (stop as soon as the reader has gone) */
+	      pthread_mutex_unlock (& merge . lock);
+	      more = render_stream_row (stream, item . values, item . keys);
+	      item_free (& item, model -> cols);
+	      pthread_mutex_lock (& merge . lock);
+	      nitems ++;
+	      if (! more)
+		break;
+	    }
+	  else
+	    {
+	      if (! (nitems % 1024))
+		items = realloc (items, (nitems + 1024) * sizeof (item_t));
+	      items [nitems ++] = item;
+	    }
+	}
+
+      /* Stop the connections not yet drained (eg. enough rows) */
+      merge . quit = true;
+      pthread_cond_broadcast (& merge . consumed);
+      pthread_mutex_unlock (& merge . lock);
+
+      free (heap . index);
+    }
+  else
+    {
+      pthread_mutex_lock (& merge . lock);
+      merge . quit = true;
+      pthread_cond_broadcast (& merge . consumed);
+      pthread_mutex_unlock (& merge . lock);
+    }
+
+  for (i = 0; i < n; i ++)
+    if (shards [i] . started)
+      pthread_join (shards [i] . tid, NULL);
+
+  /* Re-enable ^C to its previous handler */
+  signal (SIGINT, on_prev);
+
+  if (streaming)
+    {
+      if (! render_stream_end (stream) && ! quiet && fmt != OPT_JSON && fmt != OPT_JSONL)
+	printf ("%s: no data to display\n", progname);
+
+      /* Client-side timing breakdown */
+      if (osh_timing_enabled (timing))
+	osh_timing_print (progname);
+
+      nitems = 0;
+    }
+  else if (failed)
+    {
+      if (! quiet)
+	{
+	  if (! bad && ! kinds)
+	    printf ("failed\n");
+	  for (i = 0; i < n; i ++)
+	    if (shards [i] . error)
+	      printf ("%s: Error! %s - [%s]\n", progname, osh_connection_name (shards [i] . conn), shards [i] . error);
+	}
+    }
+  else
+    {
+      /* Combine the rows with the same groups */
+      if (combined)
+	{
+	  nitems = aggregate (items, nitems, kinds, model -> types, model -> cols);
+	  if (wsize)
+	    for (; nitems > wsize; nitems --)
+	      item_free (& items [nitems - 1], model -> cols);
+	}
+
+      if (! quiet)
+	printf ("Ok! #%u records from #%u connections in %s\n", nitems, n, ns2a (nswall () - t1));
+
+      /* One logical result */
+      rows = osh_rows_alloc (model -> cols, model -> names, model -> types);
+      for (i = 0; i < nitems; i ++)
+	osh_rows_add (rows, items [i] . values, items [i] . keys);
+      nitems = 0;
+
+      snprintf (source, sizeof (source), "#%u connections", n);
+      rows -> database = strdup (source);
+      rows -> user     = strdup (on ? on : "*");
+      rows -> sql      = strdup (merge . query);
+
+      /* Render the rows in one of available format */
+      if (rows -> n)
+	switch (fmt)
+	  {
+	  case OPT_CURSES:   print_curses_rows (rows, wsize, OSH_PACKAGE, OSH_VERSION); break;
+	  default:           render_rows (rows, 0, render_format (fmt));            break;
+	  }
+      else if (fmt == OPT_JSON)
+	render_rows (rows, 0, OSH_RENDER_JSON);              /* an empty array */
+      else if (! quiet)
+	printf ("%s: no data to display\n", progname);
+
+      osh_rows_free (rows);
+
+      /* Client-side timing breakdown */
+      if (osh_timing_enabled (timing))
+	osh_timing_print (progname);
+    }
+
+  interrupted = false;
+
+  /* Memory cleanup */
+  for (i = 0; i < nitems; i ++)
+    item_free (& items [i], model -> cols);
+  safefree (items);
+  for (i = 0; i < n; i ++)
+    {
+      while (shards [i] . count)
+	{
+	  item_t item = take_head (& merge, & shards [i]);
+	  item_free (& item, shards [i] . cols);
+	}
+      for (c = 0; c < shards [i] . cols; c ++)
+	safefree (shards [i] . names [c]);
+      safefree (shards [i] . names);
+      safefree (shards [i] . types);
+      safefree (shards [i] . error);
+    }
+  free (shards);
+  safefree (kinds);
+  safefree (by);
+  safefree (bad);
+  pthread_cond_destroy (& merge . consumed);
+  pthread_cond_destroy (& merge . produced);
+  pthread_mutex_destroy (& merge . lock);
+  safefree (merge . query);
+
+  /* Bye bye! */
+  return failed ? 1 : 0;
+}